@@ -0,0 +1,796 @@
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Standard C header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Azure_batch.h"
+#include "HRC_text.h"
+#include "HRC_stats.h"
+
+// IoT Hub device SDK header files
+#include "iothub_device_client_ll.h"
+#include "iothub_message.h"
+#include "azure_c_shared_utility/threadapi.h"
+
+// Wait after a failed flush before the age limit triggers another attempt.
+#define TELEMETRY_BATCH_RETRY_MS 1000
+
+// Longest TelemetryBatch_Destroy waits for the confirmations of the messages in flight.
+#define TELEMETRY_BATCH_DRAIN_MS 2000
+
+// Largest encoded record, stream and offset included.
+#define TELEMETRY_MAX_RECORD_SIZE 256
+
+// JSON body: the wall clock time of the first record in milliseconds since the epoch, then the records,
+// each with its offset from that time, e.g. {"t":1760000000000,"r":[{"dt":0,"temperature":31.50},{"dt":12,"heartRate":72}]}
+// The pieces are written with HRC_TEXT, the integer formatting avoids printf on every record.
+static const char g_jsonHeaderStart[] = "{\"t\":";
+static const char g_jsonHeaderEnd[] = ",\"r\":[";
+static const char g_jsonRecordStart[] = "{\"dt\":";
+static const char g_jsonTrailer[] = "]}";
+
+// CBOR body keys, the records are arrays of [stream, dt, fields...].
+#define TELEMETRY_CBOR_KEY_TIME    0
+#define TELEMETRY_CBOR_KEY_RECORDS 1
+
+// CBOR major types and simple values (RFC 8949).
+#define CBOR_UNSIGNED        0x00
+#define CBOR_NEGATIVE        0x20
+#define CBOR_ARRAY           0x80
+#define CBOR_MAP             0xA0
+#define CBOR_NULL            0xF6
+#define CBOR_INDEFINITE      0x1F
+#define CBOR_BREAK           0xFF
+
+// Metadata to add to telemetry messages.
+static const char g_jsonContentType[] = "application/json";
+static const char g_utf8EncodingType[] = "utf8";
+static const char g_cborContentType[] = "application/cbor";
+// Application property marking a message that was kept in the store, its records are not live.
+static const char g_backfillPropertyName[] = "backfill";
+static const char g_backfillPropertyValue[] = "true";
+
+typedef struct TELEMETRY_FIELD_TAG
+{
+	const char* name;
+	// Digits after the decimal point of the integer value.
+	uint8_t decimals;
+}
+TELEMETRY_FIELD;
+
+typedef struct TELEMETRY_SCHEMA_TAG
+{
+	const char* name;
+	uint8_t fieldCount;
+	TELEMETRY_FIELD fields[TELEMETRY_MAX_FIELDS];
+}
+TELEMETRY_SCHEMA;
+
+// Fields of each stream; the CBOR stream number is the index.
+static const TELEMETRY_SCHEMA g_telemetrySchemas[TELEMETRY_STREAM_COUNT] =
+{
+	[TELEMETRY_STREAM_WORKING_SET] = { "workingSet", 1, { { "workingSet", 0 } } },
+	[TELEMETRY_STREAM_TEMPERATURE] = { "temperature", 2, { { "temperature", 2 }, { "sensor", 0 } } },
+	[TELEMETRY_STREAM_HEART_RATE] = { "heartRate", 4, { { "heartRate", 0 }, { "confidence", 0 }, { "spo2", 1 }, { "sensor", 0 } } },
+	[TELEMETRY_STREAM_PROCESS] = { "process", 8, { { "cpu", 1 }, { "switches", 0 }, { "preemptions", 0 }, { "majorFaults", 0 },
+		{ "i2cErrors", 0 }, { "ringDepth", 0 }, { "inFlight", 0 }, { "stored", 0 } } },
+};
+
+static const char* g_encodingNames[TELEMETRY_ENCODING_COUNT] = { "json", "cbor" };
+
+static const unsigned int g_latencyBucketBoundsMs[TELEMETRY_LATENCY_BUCKETS - 1] = TELEMETRY_LATENCY_BUCKET_BOUNDS_MS;
+
+// Message under construction for one encoding.
+typedef struct TELEMETRY_BODY_TAG
+{
+	// config.maxBytes long.
+	unsigned char* data;
+	size_t length;
+	size_t records;
+	// Monotonic time of the first record, for the offsets and the age limit.
+	uint64_t baseMs;
+	// Monotonic time before which DoWork does not retry a failed flush.
+	uint64_t retryMs;
+}
+TELEMETRY_BODY;
+
+struct TELEMETRY_BATCH_TAG;
+
+// Context of one message awaiting its send confirmation.
+typedef struct TELEMETRY_IN_FLIGHT_TAG
+{
+	// NULL for a free slot, or once the batch was destroyed with the message still in flight.
+	struct TELEMETRY_BATCH_TAG* batch;
+	bool busy;
+	// Monotonic time the message was handed to the client.
+	uint64_t sentMs;
+}
+TELEMETRY_IN_FLIGHT;
+
+typedef struct TELEMETRY_BATCH_TAG
+{
+	IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient;
+	TELEMETRY_BATCH_CONFIG config;
+	TELEMETRY_BODY bodies[TELEMETRY_ENCODING_COUNT];
+	TELEMETRY_BATCH_STATS stats;
+	// Messages go to the store while the client reports no connection.
+	TELEMETRY_STORE_HANDLE store;
+	bool connected;
+	// Monotonic time of the next stored message to send.
+	uint64_t replayMs;
+	// config.maxInFlight slots.
+	TELEMETRY_IN_FLIGHT* window;
+}
+TELEMETRY_BATCH;
+
+static uint64_t GetTimeMs(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//
+// CBOR writers. Each returns the bytes written, the caller guarantees room for a head (9 bytes).
+//
+static size_t CborPutHead(unsigned char* out, unsigned char major, uint64_t value)
+{
+	size_t size, i;
+
+	if (value < 24)
+	{
+		out[0] = major | (unsigned char)value;
+		return 1;
+	}
+
+	size = value <= UINT8_MAX ? 1 : value <= UINT16_MAX ? 2 : value <= UINT32_MAX ? 4 : 8;
+	// additional information 24..27 for 1, 2, 4 and 8 byte arguments
+	out[0] = major | (unsigned char)(size == 1 ? 24 : size == 2 ? 25 : size == 4 ? 26 : 27);
+	for (i = 0; i < size; i++)
+	{
+		out[size - i] = (unsigned char)(value >> (8 * i));
+	}
+
+	return size + 1;
+}
+
+static size_t CborPutInt(unsigned char* out, int32_t value)
+{
+	if (value == TELEMETRY_VALUE_ABSENT)
+	{
+		out[0] = CBOR_NULL;
+		return 1;
+	}
+
+	return value < 0 ? CborPutHead(out, CBOR_NEGATIVE, (uint64_t)(-1 - (int64_t)value)) : CborPutHead(out, CBOR_UNSIGNED, (uint64_t)value);
+}
+
+static size_t EncodeHeader(TELEMETRY_ENCODING encoding, unsigned char* out, size_t size, uint64_t timeMs)
+{
+	size_t length = 0;
+	HRC_TEXT text;
+
+	if (encoding == TELEMETRY_ENCODING_CBOR)
+	{
+		length += CborPutHead(out + length, CBOR_MAP, 2);
+		length += CborPutHead(out + length, CBOR_UNSIGNED, TELEMETRY_CBOR_KEY_TIME);
+		length += CborPutHead(out + length, CBOR_UNSIGNED, timeMs);
+		length += CborPutHead(out + length, CBOR_UNSIGNED, TELEMETRY_CBOR_KEY_RECORDS);
+		// indefinite length array, the record count is only known at the flush
+		out[length++] = CBOR_ARRAY | CBOR_INDEFINITE;
+		return length;
+	}
+
+	HRC_TextInit(&text, (char*)out, size);
+	HRC_TextPutString(&text, g_jsonHeaderStart);
+	HRC_TextPutUint(&text, timeMs);
+	HRC_TextPutString(&text, g_jsonHeaderEnd);
+	return text.overflow ? 0 : text.length;
+}
+
+// EncodeRecord writes one record to out, TELEMETRY_MAX_RECORD_SIZE long; returns 0 when it does not fit.
+static size_t EncodeRecord(TELEMETRY_ENCODING encoding, unsigned char* out, TELEMETRY_STREAM stream, uint64_t dtMs, const int32_t* values, bool first)
+{
+	const TELEMETRY_SCHEMA* schema = &g_telemetrySchemas[stream];
+	size_t length = 0;
+	HRC_TEXT text;
+	uint8_t i;
+
+	if (encoding == TELEMETRY_ENCODING_CBOR)
+	{
+		// worst case is 9 bytes per item, well inside TELEMETRY_MAX_RECORD_SIZE
+		length += CborPutHead(out + length, CBOR_ARRAY, 2 + schema->fieldCount);
+		length += CborPutHead(out + length, CBOR_UNSIGNED, stream);
+		length += CborPutHead(out + length, CBOR_UNSIGNED, dtMs);
+		for (i = 0; i < schema->fieldCount; i++)
+		{
+			length += CborPutInt(out + length, values[i]);
+		}
+		return length;
+	}
+
+	HRC_TextInit(&text, (char*)out, TELEMETRY_MAX_RECORD_SIZE);
+	if (!first)
+	{
+		HRC_TextPutChar(&text, ',');
+	}
+	HRC_TextPutString(&text, g_jsonRecordStart);
+	HRC_TextPutUint(&text, dtMs);
+
+	for (i = 0; i < schema->fieldCount; i++)
+	{
+		if (values[i] != TELEMETRY_VALUE_ABSENT)
+		{
+			HRC_TextPutString(&text, ",\"");
+			HRC_TextPutString(&text, schema->fields[i].name);
+			HRC_TextPutString(&text, "\":");
+			HRC_TextPutDecimal(&text, values[i], schema->fields[i].decimals);
+		}
+	}
+	HRC_TextPutChar(&text, '}');
+
+	return text.overflow ? 0 : text.length;
+}
+
+static size_t EncodeTrailer(TELEMETRY_ENCODING encoding, unsigned char* out)
+{
+	if (encoding == TELEMETRY_ENCODING_CBOR)
+	{
+		out[0] = CBOR_BREAK;
+		return 1;
+	}
+
+	memcpy(out, g_jsonTrailer, sizeof(g_jsonTrailer) - 1);
+	return sizeof(g_jsonTrailer) - 1;
+}
+
+bool TelemetryBatch_ParseConfig(TELEMETRY_BATCH_CONFIG* config, const char* settings)
+{
+	char key[16];
+	unsigned long value;
+	int consumed;
+
+	while (settings != NULL && *settings != '\0')
+	{
+		if (sscanf(settings, "%15[^=]=%lu%n", key, &value, &consumed) != 2)
+		{
+			printf("Bad telemetry batch setting '%s'\n", settings);
+			return false;
+		}
+
+		if (strcmp(key, "count") == 0 && value > 0)
+		{
+			config->maxRecords = value;
+		}
+		else if (strcmp(key, "bytes") == 0 && value >= 64)
+		{
+			config->maxBytes = value;
+		}
+		else if (strcmp(key, "age") == 0)
+		{
+			config->maxAgeMs = (unsigned int)value;
+		}
+		else if (strcmp(key, "window") == 0 && value > 0 && value <= TELEMETRY_BATCH_MAX_IN_FLIGHT)
+		{
+			config->maxInFlight = value;
+		}
+		else
+		{
+			printf("Bad telemetry batch setting '%s'\n", settings);
+			return false;
+		}
+
+		settings += consumed;
+		if (*settings == ',')
+		{
+			settings++;
+		}
+	}
+
+	return true;
+}
+
+static bool ParseEncodingName(const char* name, TELEMETRY_ENCODING* encoding)
+{
+	int i;
+
+	for (i = 0; i < TELEMETRY_ENCODING_COUNT; i++)
+	{
+		if (strcmp(name, g_encodingNames[i]) == 0)
+		{
+			*encoding = (TELEMETRY_ENCODING)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TelemetryBatch_ParseEncoding(TELEMETRY_BATCH_CONFIG* config, const char* settings)
+{
+	TELEMETRY_ENCODING encoding;
+	char stream[24], name[8];
+	int consumed, i;
+
+	if (settings == NULL || *settings == '\0')
+	{
+		return true;
+	}
+
+	if (ParseEncodingName(settings, &encoding))
+	{
+		for (i = 0; i < TELEMETRY_STREAM_COUNT; i++)
+		{
+			config->encoding[i] = encoding;
+		}
+		return true;
+	}
+
+	while (*settings != '\0')
+	{
+		if (sscanf(settings, "%23[^=]=%7[^,]%n", stream, name, &consumed) != 2 || ParseEncodingName(name, &encoding) == false)
+		{
+			printf("Bad telemetry encoding setting '%s'\n", settings);
+			return false;
+		}
+
+		for (i = 0; i < TELEMETRY_STREAM_COUNT && strcmp(stream, g_telemetrySchemas[i].name) != 0; i++)
+			;
+		if (i == TELEMETRY_STREAM_COUNT)
+		{
+			printf("Unknown telemetry stream '%s'\n", stream);
+			return false;
+		}
+		config->encoding[i] = encoding;
+
+		settings += consumed;
+		if (*settings == ',')
+		{
+			settings++;
+		}
+	}
+
+	return true;
+}
+
+//
+// ConnectionStatusCallback follows the connection of the device client; until the first report it is assumed up,
+// as the client queues what is sent while it connects.
+//
+static void ConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason, void* userContextCallback)
+{
+	TELEMETRY_BATCH* batch = (TELEMETRY_BATCH*)userContextCallback;
+
+	batch->connected = result == IOTHUB_CLIENT_CONNECTION_AUTHENTICATED;
+	printf("IoT Hub connection %s, reason=%d\n", batch->connected ? "up" : "down", reason);
+}
+
+TELEMETRY_BATCH_HANDLE TelemetryBatch_Create(IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient, const TELEMETRY_BATCH_CONFIG* config)
+{
+	TELEMETRY_BATCH* batch;
+	int i;
+
+	if ((batch = (TELEMETRY_BATCH*)calloc(1, sizeof(TELEMETRY_BATCH))) == NULL)
+	{
+		printf("Unable to allocate telemetry batch");
+		return NULL;
+	}
+
+	batch->deviceClient = deviceClient;
+	batch->config = *config;
+	batch->connected = true;
+
+	if ((batch->window = (TELEMETRY_IN_FLIGHT*)calloc(config->maxInFlight, sizeof(TELEMETRY_IN_FLIGHT))) == NULL)
+	{
+		printf("Unable to allocate the in-flight window");
+		free(batch);
+		return NULL;
+	}
+
+	for (i = 0; i < TELEMETRY_ENCODING_COUNT; i++)
+	{
+		if ((batch->bodies[i].data = (unsigned char*)malloc(config->maxBytes)) == NULL)
+		{
+			printf("Unable to allocate telemetry batch body of %zu bytes", config->maxBytes);
+			TelemetryBatch_Destroy(batch);
+			return NULL;
+		}
+	}
+
+	if (IoTHubDeviceClient_LL_SetConnectionStatusCallback(deviceClient, ConnectionStatusCallback, batch) != IOTHUB_CLIENT_OK)
+	{
+		printf("Unable to follow the connection status, telemetry is always sent\n");
+	}
+
+	return batch;
+}
+
+void TelemetryBatch_Destroy(TELEMETRY_BATCH_HANDLE batchHandle)
+{
+	unsigned int waitedMs;
+	size_t i;
+
+	if (batchHandle != NULL)
+	{
+		(void)TelemetryBatch_Flush(batchHandle);
+
+		for (waitedMs = 0; batchHandle->stats.inFlight > 0 && waitedMs < TELEMETRY_BATCH_DRAIN_MS; waitedMs += 10)
+		{
+			IoTHubDeviceClient_LL_DoWork(batchHandle->deviceClient);
+			ThreadAPI_Sleep(10);
+		}
+
+		if (batchHandle->stats.inFlight > 0)
+		{
+			// The client still holds pointers into the window and calls back when it is destroyed.
+			printf("%u telemetry messages still in flight\n", batchHandle->stats.inFlight);
+			for (i = 0; i < batchHandle->config.maxInFlight; i++)
+			{
+				batchHandle->window[i].batch = NULL;
+			}
+		}
+		else
+		{
+			free(batchHandle->window);
+		}
+
+		// The client outlives the batch and would report its last status changes into freed memory.
+		(void)IoTHubDeviceClient_LL_SetConnectionStatusCallback(batchHandle->deviceClient, NULL, NULL);
+
+		for (i = 0; i < TELEMETRY_ENCODING_COUNT; i++)
+		{
+			free(batchHandle->bodies[i].data);
+		}
+		free(batchHandle);
+	}
+}
+
+void TelemetryBatch_SetStore(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STORE_HANDLE storeHandle)
+{
+	batchHandle->store = storeHandle;
+}
+
+void TelemetryBatch_SetEncoding(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STREAM stream, TELEMETRY_ENCODING encoding)
+{
+	batchHandle->config.encoding[stream] = encoding;
+}
+
+// AppendRecord adds one record to the body if it fits with room left for the trailer.
+static bool AppendRecord(TELEMETRY_BATCH* batch, TELEMETRY_ENCODING encoding, TELEMETRY_STREAM stream, const int32_t* values, uint64_t nowMs)
+{
+	TELEMETRY_BODY* body = &batch->bodies[encoding];
+	unsigned char record[TELEMETRY_MAX_RECORD_SIZE];
+	size_t limit = batch->config.maxBytes - sizeof(g_jsonTrailer);
+	size_t length;
+
+	if (body->records == 0)
+	{
+		body->baseMs = nowMs;
+		if ((body->length = EncodeHeader(encoding, body->data, limit, GetTimeMs(CLOCK_REALTIME))) == 0)
+		{
+			return false;
+		}
+	}
+
+	HRC_STATS_START(encodeStart);
+	length = EncodeRecord(encoding, record, stream, nowMs - body->baseMs, values, body->records == 0);
+	HRC_STATS_STOP(HRC_STAGE_ENCODE, encodeStart);
+	if (length == 0 || body->length + length > limit)
+	{
+		return false;
+	}
+
+	memcpy(body->data + body->length, record, length);
+	body->length += length;
+	body->records++;
+	return true;
+}
+
+//
+// SendConfirmationCallback is invoked by the client when a message was delivered or given up on.
+//
+static void SendConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+	TELEMETRY_IN_FLIGHT* slot = (TELEMETRY_IN_FLIGHT*)userContextCallback;
+	TELEMETRY_BATCH* batch = slot->batch;
+	uint64_t latencyMs;
+	size_t bucket;
+
+	slot->busy = false;
+	if (batch == NULL)
+	{
+		return;
+	}
+
+	batch->stats.inFlight--;
+	if (result == IOTHUB_CLIENT_CONFIRMATION_OK)
+	{
+		latencyMs = GetTimeMs(CLOCK_MONOTONIC) - slot->sentMs;
+		for (bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS - 1 && latencyMs > g_latencyBucketBoundsMs[bucket]; bucket++)
+			;
+		batch->stats.latency[bucket]++;
+		HRC_STATS_RECORD(HRC_STAGE_ACK, (uint32_t)latencyMs * 1000);
+		if (latencyMs > batch->stats.maxLatencyMs)
+		{
+			batch->stats.maxLatencyMs = (uint32_t)latencyMs;
+		}
+		batch->stats.confirmed++;
+	}
+	else
+	{
+		printf("Telemetry message not delivered, result=%d\n", result);
+		batch->stats.undelivered++;
+	}
+}
+
+// WindowHasRoom is true when a message can be sent with reserve slots of the window left over.
+static bool WindowHasRoom(TELEMETRY_BATCH* batch, size_t reserve)
+{
+	return batch->stats.inFlight + reserve < batch->config.maxInFlight;
+}
+
+//
+// SendMessage hands one message body to the IoT Hub client and tracks it until it is confirmed.
+// The caller checks that the window has room.
+//
+static bool SendMessage(TELEMETRY_BATCH* batch, const unsigned char* data, size_t length, const char* contentType, const char* contentEncoding, bool backfill)
+{
+	IOTHUB_MESSAGE_HANDLE messageHandle = NULL;
+	IOTHUB_MESSAGE_RESULT messageResult;
+	IOTHUB_CLIENT_RESULT iothubClientResult;
+	TELEMETRY_IN_FLIGHT* slot;
+	size_t i;
+	bool result = false;
+
+	for (i = 0; i < batch->config.maxInFlight && batch->window[i].busy; i++)
+		;
+	if (i == batch->config.maxInFlight)
+	{
+		return false;
+	}
+	slot = &batch->window[i];
+
+	// Create the message handle and specify its metadata.
+	if ((messageHandle = IoTHubMessage_CreateFromByteArray(data, length)) == NULL)
+	{
+		printf("IoTHubMessage_CreateFromByteArray failed");
+	}
+	else if ((messageResult = IoTHubMessage_SetContentTypeSystemProperty(messageHandle, contentType)) != IOTHUB_MESSAGE_OK)
+	{
+		printf("IoTHubMessage_SetContentTypeSystemProperty failed, error=%d", messageResult);
+	}
+	else if (contentEncoding != NULL && (messageResult = IoTHubMessage_SetContentEncodingSystemProperty(messageHandle, contentEncoding)) != IOTHUB_MESSAGE_OK)
+	{
+		printf("IoTHubMessage_SetContentEncodingSystemProperty failed, error=%d", messageResult);
+	}
+	else if (backfill && (messageResult = IoTHubMessage_SetProperty(messageHandle, g_backfillPropertyName, g_backfillPropertyValue)) != IOTHUB_MESSAGE_OK)
+	{
+		printf("IoTHubMessage_SetProperty failed, error=%d", messageResult);
+	}
+	else
+	{
+		// Claim the slot first, the client may confirm from within the call.
+		slot->batch = batch;
+		slot->busy = true;
+		slot->sentMs = GetTimeMs(CLOCK_MONOTONIC);
+		batch->stats.inFlight++;
+
+		// Send the telemetry message.
+		if ((iothubClientResult = IoTHubDeviceClient_LL_SendEventAsync(batch->deviceClient, messageHandle, SendConfirmationCallback, slot)) != IOTHUB_CLIENT_OK)
+		{
+			printf("Unable to send telemetry message, error=%d", iothubClientResult);
+			slot->busy = false;
+			batch->stats.inFlight--;
+		}
+		else
+		{
+			if (batch->stats.inFlight > batch->stats.maxInFlight)
+			{
+				batch->stats.maxInFlight = batch->stats.inFlight;
+			}
+			result = true;
+		}
+	}
+
+	IoTHubMessage_Destroy(messageHandle);
+
+	return result;
+}
+
+static bool SendBody(TELEMETRY_BATCH* batch, const unsigned char* data, size_t length, TELEMETRY_ENCODING encoding, bool backfill)
+{
+	if (encoding == TELEMETRY_ENCODING_CBOR)
+	{
+		return SendMessage(batch, data, length, g_cborContentType, NULL, backfill);
+	}
+
+	return SendMessage(batch, data, length, g_jsonContentType, g_utf8EncodingType, backfill);
+}
+
+// FlushBody sends one encoding's records as a message, or stores it; true when nothing is left to send.
+static bool FlushBody(TELEMETRY_BATCH* batch, TELEMETRY_ENCODING encoding)
+{
+	TELEMETRY_BODY* body = &batch->bodies[encoding];
+	bool windowFull = false;
+	size_t length;
+	bool result = false;
+
+	if (body->records == 0)
+	{
+		return true;
+	}
+
+	// AppendRecord always leaves room for the trailer.
+	length = body->length + EncodeTrailer(encoding, body->data + body->length);
+
+	// Live records go out first, stored messages follow as backfill; each body carries its own time.
+	if (batch->store == NULL || batch->connected)
+	{
+		if (WindowHasRoom(batch, 0) == false)
+		{
+			windowFull = true;
+		}
+		else if ((result = SendBody(batch, body->data, length, encoding, false)) == true)
+		{
+			batch->stats.messages++;
+		}
+	}
+
+	if (result == false && batch->store != NULL && (result = TelemetryStore_Append(batch->store, body->data, length, (uint8_t)encoding)) == true)
+	{
+		batch->stats.stored++;
+	}
+
+	if (result)
+	{
+		HRC_STATS_RECORD(HRC_STAGE_QUEUE, (uint32_t)(GetTimeMs(CLOCK_MONOTONIC) - body->baseMs) * 1000);
+		batch->stats.records += body->records;
+		body->records = 0;
+		body->length = 0;
+	}
+	else if (windowFull)
+	{
+		// Retried on the next DoWork; meanwhile the message takes more records, up to maxBytes.
+		batch->stats.deferred++;
+	}
+	else
+	{
+		// Keep the records, the trailer is written again on the next attempt.
+		body->retryMs = GetTimeMs(CLOCK_MONOTONIC) + TELEMETRY_BATCH_RETRY_MS;
+		batch->stats.failures++;
+	}
+
+	return result;
+}
+
+//
+// ReplayStored sends stored messages, oldest first, at no more than the replay rate of the store.
+// A message is taken out of the store once the client accepted it.  One slot of the window is kept for live records.
+//
+static void ReplayStored(TELEMETRY_BATCH* batch, uint64_t nowMs)
+{
+	unsigned int rate = TelemetryStore_GetReplayRate(batch->store);
+	uint64_t intervalMs = rate < 1000 ? 1000 / rate : 1;
+	const unsigned char* data;
+	size_t length;
+	uint8_t encoding;
+
+	// No burst to make up for the time the store was empty.
+	if (batch->replayMs + intervalMs < nowMs)
+	{
+		batch->replayMs = nowMs;
+	}
+
+	while (batch->connected && batch->replayMs <= nowMs && WindowHasRoom(batch, 1) && TelemetryStore_Peek(batch->store, &data, &length, &encoding))
+	{
+		if (SendBody(batch, data, length, (TELEMETRY_ENCODING)encoding, true) == false)
+		{
+			batch->replayMs = nowMs + TELEMETRY_BATCH_RETRY_MS;
+			break;
+		}
+
+		TelemetryStore_Remove(batch->store);
+		batch->stats.replayed++;
+		batch->replayMs += intervalMs;
+	}
+}
+
+bool TelemetryBatch_Add(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STREAM stream, const int32_t* values)
+{
+	TELEMETRY_ENCODING encoding = batchHandle->config.encoding[stream];
+	uint64_t nowMs = GetTimeMs(CLOCK_MONOTONIC);
+	bool result;
+
+	result = AppendRecord(batchHandle, encoding, stream, values, nowMs);
+
+	// Full: send what is queued and start a new message with this record.
+	if (result == false && batchHandle->bodies[encoding].records > 0 && FlushBody(batchHandle, encoding))
+	{
+		result = AppendRecord(batchHandle, encoding, stream, values, nowMs);
+	}
+
+	if (result == false)
+	{
+		printf("Telemetry record dropped: %s\n", g_telemetrySchemas[stream].name);
+		batchHandle->stats.dropped++;
+	}
+	else if (batchHandle->bodies[encoding].records >= batchHandle->config.maxRecords)
+	{
+		(void)FlushBody(batchHandle, encoding);
+	}
+
+	return result;
+}
+
+bool TelemetryBatch_Flush(TELEMETRY_BATCH_HANDLE batchHandle)
+{
+	bool result = true;
+	int i;
+
+	for (i = 0; i < TELEMETRY_ENCODING_COUNT; i++)
+	{
+		if (FlushBody(batchHandle, (TELEMETRY_ENCODING)i) == false)
+		{
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+bool TelemetryBatch_SendBulk(TELEMETRY_BATCH_HANDLE batchHandle, const unsigned char* data, size_t length, const char* contentType)
+{
+	if (batchHandle->connected && WindowHasRoom(batchHandle, 1) && SendMessage(batchHandle, data, length, contentType, NULL, false))
+	{
+		batchHandle->stats.bulkMessages++;
+		return true;
+	}
+
+	batchHandle->stats.bulkDropped++;
+	return false;
+}
+
+void TelemetryBatch_DoWork(TELEMETRY_BATCH_HANDLE batchHandle)
+{
+	uint64_t nowMs = GetTimeMs(CLOCK_MONOTONIC);
+	TELEMETRY_BODY* body;
+	int i;
+
+	for (i = 0; i < TELEMETRY_ENCODING_COUNT; i++)
+	{
+		body = &batchHandle->bodies[i];
+		if (body->records > 0 && (nowMs - body->baseMs >= batchHandle->config.maxAgeMs || body->records >= batchHandle->config.maxRecords) && nowMs >= body->retryMs)
+		{
+			(void)FlushBody(batchHandle, (TELEMETRY_ENCODING)i);
+		}
+	}
+
+	if (batchHandle->store != NULL)
+	{
+		TelemetryStore_DoWork(batchHandle->store);
+		ReplayStored(batchHandle, nowMs);
+	}
+}
+
+void TelemetryBatch_GetStats(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_BATCH_STATS* stats)
+{
+	*stats = batchHandle->stats;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AZURE_BATCH_H
+#define AZURE_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "iothub_device_client_ll.h"
+
+#include "Azure_store.h"
+
+//
+// Telemetry types, each with a fixed schema of integer fields (see g_telemetrySchemas).
+//
+typedef enum TELEMETRY_STREAM_TAG
+{
+	// workingSet [KiB]
+	TELEMETRY_STREAM_WORKING_SET,
+	// temperature [0.01 degC], sensor number or absent when there is one sensor
+	TELEMETRY_STREAM_TEMPERATURE,
+	// heartRate [bpm], confidence [%], spo2 [0.1 %] or absent, sensor number or absent when there is one sensor
+	TELEMETRY_STREAM_HEART_RATE,
+	// cpu [0.1 %], switches, preemptions, majorFaults, i2cErrors (totals since start),
+	// ringDepth [samples], inFlight [messages], stored [messages]
+	TELEMETRY_STREAM_PROCESS,
+	TELEMETRY_STREAM_COUNT
+}
+TELEMETRY_STREAM;
+
+#define TELEMETRY_MAX_FIELDS 8
+
+// Field value left out of the record: the key is omitted in JSON, null in CBOR.
+#define TELEMETRY_VALUE_ABSENT INT32_MIN
+
+// TELEMETRY_ENCODING is in Azure_store.h, the store keeps it with every message.
+
+// Upper bounds of the send-to-confirmation latency buckets in milliseconds; the last bucket takes everything slower.
+#define TELEMETRY_LATENCY_BUCKET_BOUNDS_MS { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000 }
+#define TELEMETRY_LATENCY_BUCKETS 10
+
+// Largest in-flight window.
+#define TELEMETRY_BATCH_MAX_IN_FLIGHT 32
+
+//
+// Limits that trigger a flush, whichever is reached first. They apply to each encoding separately.
+//
+typedef struct TELEMETRY_BATCH_CONFIG_TAG
+{
+	// Records per message.
+	size_t maxRecords;
+	// Size of the message body, including the base timestamp and brackets.
+	size_t maxBytes;
+	// Age of the oldest record in milliseconds.
+	unsigned int maxAgeMs;
+	// Encoding of each stream.
+	TELEMETRY_ENCODING encoding[TELEMETRY_STREAM_COUNT];
+	// Messages handed to the IoT Hub client and not yet confirmed. While the window is full, telemetry goes to the
+	// store if there is one, otherwise the records wait and the messages grow up to maxBytes.
+	size_t maxInFlight;
+}
+TELEMETRY_BATCH_CONFIG;
+
+#define TELEMETRY_BATCH_CONFIG_DEFAULT { 16, 1024, 30000, { TELEMETRY_ENCODING_JSON }, 8 }
+
+typedef struct TELEMETRY_BATCH_STATS_TAG
+{
+	// Messages handed to the IoT Hub client.
+	uint32_t messages;
+	// Messages written to the store instead, and stored messages sent later.
+	uint32_t stored;
+	uint32_t replayed;
+	// Records carried by the messages sent or stored.
+	uint32_t records;
+	// Records that did not fit and could not be flushed.
+	uint32_t dropped;
+	// Flushes that failed; their records stay queued for the next one.
+	uint32_t failures;
+	// Flushes put off because the in-flight window was full.
+	uint32_t deferred;
+	// Bulk messages (TelemetryBatch_SendBulk) sent, and dropped because the window was full or the send failed.
+	uint32_t bulkMessages;
+	uint32_t bulkDropped;
+	// Messages the client confirmed, and reported as not delivered (timeout, error or client destroyed).
+	uint32_t confirmed;
+	uint32_t undelivered;
+	// Messages awaiting confirmation now, and the most there have been.
+	uint32_t inFlight;
+	uint32_t maxInFlight;
+	// Send-to-confirmation latency of the confirmed messages (see TELEMETRY_LATENCY_BUCKET_BOUNDS_MS).
+	uint32_t latency[TELEMETRY_LATENCY_BUCKETS];
+	uint32_t maxLatencyMs;
+}
+TELEMETRY_BATCH_STATS;
+
+//
+// Handle collecting readings from all components into one telemetry message.
+//
+typedef struct TELEMETRY_BATCH_TAG* TELEMETRY_BATCH_HANDLE;
+
+//
+// TelemetryBatch_ParseConfig reads "count=16,bytes=1024,age=30000,window=8" into config; omitted keys keep their value.
+//
+bool TelemetryBatch_ParseConfig(TELEMETRY_BATCH_CONFIG* config, const char* settings);
+
+//
+// TelemetryBatch_ParseEncoding reads "cbor" for all streams, or "temperature=cbor,heartRate=json" per stream, into config.
+//
+bool TelemetryBatch_ParseEncoding(TELEMETRY_BATCH_CONFIG* config, const char* settings);
+
+//
+// TelemetryBatch_Create allocates a batch sending through deviceClient.
+//
+TELEMETRY_BATCH_HANDLE TelemetryBatch_Create(IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient, const TELEMETRY_BATCH_CONFIG* config);
+
+//
+// TelemetryBatch_Destroy flushes what is queued and waits a little for the confirmations before it frees the batch.
+//
+void TelemetryBatch_Destroy(TELEMETRY_BATCH_HANDLE batchHandle);
+
+//
+// TelemetryBatch_SetStore keeps messages in storeHandle while the hub is unreachable and sends them once it is back,
+// at most the store's replay rate per second.  NULL goes back to retrying from memory.
+//
+void TelemetryBatch_SetStore(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STORE_HANDLE storeHandle);
+
+//
+// TelemetryBatch_SetEncoding switches the encoding of one stream; records already queued keep theirs.
+//
+void TelemetryBatch_SetEncoding(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STREAM stream, TELEMETRY_ENCODING encoding);
+
+//
+// TelemetryBatch_Add queues one reading, values holds the fields of the stream's schema in order.
+// It is stamped with its offset from the first record of its message. Returns false when the reading was dropped.
+//
+bool TelemetryBatch_Add(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_STREAM stream, const int32_t* values);
+
+//
+// TelemetryBatch_Flush sends the queued records, one message per encoding; true when nothing is left to send.
+//
+bool TelemetryBatch_Flush(TELEMETRY_BATCH_HANDLE batchHandle);
+
+//
+// TelemetryBatch_SendBulk sends a message outside the telemetry schema, e.g. waveform blocks, within the in-flight window.
+// One slot of the window is kept for telemetry; returns false when the message was not sent.
+//
+bool TelemetryBatch_SendBulk(TELEMETRY_BATCH_HANDLE batchHandle, const unsigned char* data, size_t length, const char* contentType);
+
+//
+// TelemetryBatch_DoWork flushes each encoding whose oldest record reached the age limit and sends stored messages.
+// Call it from the main loop.
+//
+void TelemetryBatch_DoWork(TELEMETRY_BATCH_HANDLE batchHandle);
+
+void TelemetryBatch_GetStats(TELEMETRY_BATCH_HANDLE batchHandle, TELEMETRY_BATCH_STATS* stats);
+
+#endif
@@ -29,6 +29,10 @@
 
 #include"HRC_control.c"
 #include"HRC_driver.c"
+#include "HRC_hr.h"
+#include "HRC_spo2.h"
+#include "HRC_fixed.h"
+#include "HRC_codec.h"
 
 // Core IoT SDK utilities
 #include "azure_c_shared_utility/xlogging.h"
@@ -36,9 +40,6 @@
 // Size of buffer to store ISO 8601 time.
 #define TIME_BUFFER_SIZE 128
 
-// Size of buffer to store current temperature telemetry.
-#define CURRENT_TEMPERATURE_BUFFER_SIZE  32
-
 // Size of buffer to store the maximum temp since reboot property.
 #define MAX_TEMPERATURE_SINCE_REBOOT_BUFFER_SIZE 32
 
@@ -52,21 +53,23 @@
 //static const char g_getMaxMinReportCommandName[] = "getMaxMinReport";
 
 // The default temperature to use before any is set
-#define DEFAULT_TEMPERATURE_VALUE 22
+#define DEFAULT_TEMPERATURE_VALUE HRC_Q16_FROM_INT(22)
 
 // Format string to create an ISO 8601 time.  This corresponds to the DTDL datetime schema item.
 static const char g_ISO8601Format[] = "%Y-%m-%dT%H:%M:%SZ";
 
-// Format string for sending temperature telemetry.
-static const char g_temperatureTelemetryBodyFormat[] = "{\"temperature\":%.02f}";
+// Content type of raw waveform messages, a sequence of blocks described in HRC_codec.h.
+static const char g_waveformContentType[] = "application/x-hrc-ppg";
+
+// Parameter added to the waveform content type when several sensors send, e.g. "application/x-hrc-ppg;sensor=1".
+static const char g_waveformSensorParameterFormat[] = "%s;sensor=%d";
+
+// Parameters added to the waveform content type for the format of the samples in the block, e.g. "application/x-hrc-ppg;rate=100;bits=16".
+static const char g_waveformFormatParameterFormat[] = "%s;rate=%u;bits=%u";
 
 // Format string for sending maxTempSinceLastReboot property.
 //static const char g_maxTempSinceLastRebootPropertyFormat[] = "%.2f";
 
-// Metadata to add to telemetry messages.
-static const char g_jsonContentType[] = "application/json";
-static const char g_utf8EncodingType[] = "utf8";
-
 // Start time of the program, stored in ISO 8601 format string for UTC
 char g_programStartTime[TIME_BUFFER_SIZE] = {0};
 
@@ -78,12 +81,12 @@ typedef struct THERMOSTAT_COMPONENT_TAG
 {
 	// Name of this component
 	char componentName[MAX_COMPONENT_NAME_LENGTH + 1];
-	// Current temperature of this thermostat component
-	double currentTemperature;
+	// Current temperature of this thermostat component, degrees Celsius in Q15.16
+	HRC_Q16 currentTemperature;
 	// Number of times temperature has been updated, counting the initial setting as 1.  Used to determine average temperature of this thermostat component
 	int numTemperatureUpdates;
 	// Total of all temperature updates during current execution run.  Used to determine average temperature of this thermostat component
-	double allTemperatures;
+	int64_t allTemperatures;
 }
 HR_THERMOSTAT_COMPONENT;
 
@@ -151,35 +154,67 @@ void ThermostatComponent_Destroy(HR_COMPONENT_HANDLE AzureComponentHandle)
 }
 
 
-void ThermostatComponent_SendCurrentTemperature(HR_COMPONENT_HANDLE AzureComponentHandle, IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient,int file)
+void ThermostatComponent_SendCurrentTemperature(HR_COMPONENT_HANDLE AzureComponentHandle, TELEMETRY_BATCH_HANDLE batchHandle, HRC_DEVICE* device, int32_t sensor)
 {
 	HR_THERMOSTAT_COMPONENT* hrThermostatComponent = (HR_THERMOSTAT_COMPONENT*)AzureComponentHandle;
-	IOTHUB_MESSAGE_HANDLE messageHandle = NULL;
-	IOTHUB_MESSAGE_RESULT messageResult;
-	IOTHUB_CLIENT_RESULT iothubClientResult;
-
-	char temperatureStringBuffer[CURRENT_TEMPERATURE_BUFFER_SIZE];
-	hrThermostatComponent->currentTemperature = CollectTempData(file);
-	//printf("temperature = %lf\n",hrThermostatComponent->currentTemperature);
-	// Create the telemetry message body to send.
-	if (snprintf(temperatureStringBuffer, sizeof(temperatureStringBuffer), g_temperatureTelemetryBodyFormat, hrThermostatComponent->currentTemperature) < 0)
-	{
-		printf("snprintf of current temperature telemetry failed");
-	}
-	// Create the message handle and specify its metadata.
-	else if ((messageHandle = IoTHubMessage_CreateFromString(temperatureStringBuffer)) == NULL)
+	int32_t values[2];
+
+	hrThermostatComponent->currentTemperature = CollectTempData(device);
+	// The temperature schema carries hundredths of a degree.
+	values[0] = HRC_Q16Round(100 * hrThermostatComponent->currentTemperature);
+	values[1] = sensor;
+
+	// Queue it for the next telemetry message.
+	(void)TelemetryBatch_Add(batchHandle, TELEMETRY_STREAM_TEMPERATURE, values);
+}
+
+void HRComponent_SendHeartRate(HR_COMPONENT_HANDLE AzureComponentHandle, TELEMETRY_BATCH_HANDLE batchHandle, const HRC_DEVICE* device, int32_t sensor)
+{
+	HRC_HR_RESULT heartRate;
+	HRC_SPO2_RESULT spo2;
+	int32_t values[4];
+
+	(void)AzureComponentHandle;
+	HRC_HrGetResult(&device->hr, &heartRate);
+	HRC_Spo2GetResult(&device->spo2, &spo2);
+
+	// Nothing to report until the estimator has locked on to a rhythm.
+	if (heartRate.bpm == 0)
 	{
-		printf("IoTHubMessage_CreateFromString failed");
+		return;
 	}
-	else if ((messageResult = IoTHubMessage_SetContentTypeSystemProperty(messageHandle, g_jsonContentType)) != IOTHUB_MESSAGE_OK)
+
+	values[0] = heartRate.bpm;
+	values[1] = heartRate.confidence;
+	values[2] = spo2.spo2 != 0 ? spo2.spo2 : TELEMETRY_VALUE_ABSENT;
+	values[3] = sensor;
+
+	// Queue it for the next telemetry message.
+	(void)TelemetryBatch_Add(batchHandle, TELEMETRY_STREAM_HEART_RATE, values);
+}
+
+void HRComponent_InitWaveform(HR_WAVEFORM_CONTEXT* waveformContext, TELEMETRY_BATCH_HANDLE batchHandle, int32_t sensor)
+{
+	waveformContext->batchHandle = batchHandle;
+
+	if (sensor == TELEMETRY_VALUE_ABSENT)
 	{
-		printf("IoTHubMessage_SetContentTypeSystemProperty failed, error=%d", messageResult);
+		(void)snprintf(waveformContext->contentType, sizeof(waveformContext->contentType), "%s", g_waveformContentType);
 	}
-	else if ((messageResult = IoTHubMessage_SetContentEncodingSystemProperty(messageHandle, g_utf8EncodingType)) != IOTHUB_MESSAGE_OK)
+	else
 	{
-		printf("IoTHubMessage_SetContentEncodingSystemProperty failed, error=%d", messageResult);
+		(void)snprintf(waveformContext->contentType, sizeof(waveformContext->contentType), g_waveformSensorParameterFormat, g_waveformContentType, (int)sensor);
 	}
-	// Send the telemetry message.
+}
+
+void HRComponent_SendWaveform(const uint8_t* block, size_t length, const HRC_SAMPLE_FORMAT* format, void* waveformContext)
+{
+	HR_WAVEFORM_CONTEXT* context = (HR_WAVEFORM_CONTEXT*)waveformContext;
+	char contentType[sizeof(context->contentType) + 32];
+
+	// The sample rate and resolution can change from one block to the next.
+	(void)snprintf(contentType, sizeof(contentType), g_waveformFormatParameterFormat, context->contentType, (unsigned int)format->rate, (unsigned int)format->bits);
 
-	IoTHubMessage_Destroy(messageHandle);
+	// The waveform yields to telemetry when the link falls behind, the decoder resynchronizes on the block sequence number.
+	(void)TelemetryBatch_SendBulk(context->batchHandle, block, length, contentType);
 }
@@ -19,6 +19,8 @@
 #define AZURE_COMPONENT_H
 #include "parson.h"
 #include "iothub_device_client_ll.h"
+#include "Azure_batch.h"
+#include "HRC_driver.h"
 
 //
 // Handle representing a thermostat component.
@@ -37,9 +39,39 @@ HR_COMPONENT_HANDLE CreateHandle(const char* componentName);
 void ThermostatComponent_Destroy(HR_COMPONENT_HANDLE hrThermostatComponentHandle);
 
 //
-// ThermostatComponent_SendCurrentTemperature sends a telemetry message indicating the current temperature.
+// Where HRComponent_SendWaveform sends the blocks of one sensor.
 //
-void ThermostatComponent_SendCurrentTemperature(HR_COMPONENT_HANDLE hrThermostatComponentHandle, IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient, int file);
+typedef struct HR_WAVEFORM_CONTEXT_TAG
+{
+	TELEMETRY_BATCH_HANDLE batchHandle;
+	// Content type of the messages, naming the sensor when there are several.
+	char contentType[64];
+}
+HR_WAVEFORM_CONTEXT;
+
+//
+// ThermostatComponent_SendCurrentTemperature queues a telemetry record indicating the current temperature of device.
+// sensor is the number sent with the record, TELEMETRY_VALUE_ABSENT leaves it out.
+//
+void ThermostatComponent_SendCurrentTemperature(HR_COMPONENT_HANDLE hrThermostatComponentHandle, TELEMETRY_BATCH_HANDLE batchHandle, HRC_DEVICE* device, int32_t sensor);
+
+//
+// HRComponent_SendHeartRate queues a telemetry record with the current heart rate estimate of device, its confidence and
+// SpO2 when available.  sensor is the number sent with the record, TELEMETRY_VALUE_ABSENT leaves it out.
+//
+void HRComponent_SendHeartRate(HR_COMPONENT_HANDLE hrThermostatComponentHandle, TELEMETRY_BATCH_HANDLE batchHandle, const HRC_DEVICE* device, int32_t sensor);
+
+//
+// HRComponent_InitWaveform prepares waveformContext for the sensor numbered sensor, TELEMETRY_VALUE_ABSENT when it is the only one.
+//
+void HRComponent_InitWaveform(HR_WAVEFORM_CONTEXT* waveformContext, TELEMETRY_BATCH_HANDLE batchHandle, int32_t sensor);
+
+//
+// HRComponent_SendWaveform sends one block of the losslessly coded raw IR/RED waveform, its content type naming the
+// sample rate and resolution; waveformContext is an HR_WAVEFORM_CONTEXT, the signature matches HRC_WAVEFORM_SINK.
+// Blocks are dropped while the in-flight window is full.
+//
+void HRComponent_SendWaveform(const uint8_t* block, size_t length, const HRC_SAMPLE_FORMAT* format, void* waveformContext);
 
 #endif
 
@@ -0,0 +1,686 @@
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Standard C header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "Azure_store.h"
+
+//
+// The store is a directory of segment files named by an increasing sequence number, e.g. 0000002a.seg.
+// Messages are only ever appended to the newest segment and read from the oldest one, which is deleted
+// once it has been read or evicted.  Each record is a TELEMETRY_RECORD_HEADER followed by the message;
+// records are in the byte order of the device.
+//
+#define TELEMETRY_STORE_MAGIC 0x51435248
+
+typedef struct TELEMETRY_RECORD_HEADER_TAG
+{
+	uint32_t magic;
+	uint32_t length;
+	uint8_t encoding;
+	uint8_t reserved[3];
+	// CRC-32 of the header fields above and the message.
+	uint32_t crc;
+}
+TELEMETRY_RECORD_HEADER;
+
+typedef struct TELEMETRY_SEGMENT_TAG
+{
+	uint32_t sequence;
+	// Bytes of whole, valid records.
+	size_t length;
+	uint32_t records;
+}
+TELEMETRY_SEGMENT;
+
+typedef struct TELEMETRY_STORE_TAG
+{
+	TELEMETRY_STORE_CONFIG config;
+	// Oldest first, the last one is open for appending.
+	TELEMETRY_SEGMENT segments[TELEMETRY_STORE_MAX_SEGMENTS];
+	size_t count;
+	int writeFd;
+	// Reading position in segments[0].
+	int readFd;
+	size_t readOffset;
+	uint32_t readRecords;
+	// Size of the record returned by the last peek, 0 when there is none.
+	size_t peekLength;
+	// segmentBytes long, holds the peeked message.
+	unsigned char* readBuffer;
+	// Part of the write segment not yet synced.
+	size_t dirtyStart;
+	size_t dirtyEnd;
+	uint64_t dirtySinceMs;
+	TELEMETRY_STORE_STATS stats;
+}
+TELEMETRY_STORE;
+
+static uint64_t GetTimeMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//
+// Crc32Update continues a CRC-32 (IEEE 802.3, as in zlib) over data, four bits at a time.
+// Start with 0xFFFFFFFF and invert the result.
+//
+static uint32_t Crc32Update(uint32_t crc, const unsigned char* data, size_t length)
+{
+	static const uint32_t table[16] =
+	{
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	while (length-- > 0)
+	{
+		crc ^= *data++;
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+	}
+
+	return crc;
+}
+
+static uint32_t RecordCrc(const TELEMETRY_RECORD_HEADER* header, const unsigned char* data)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	crc = Crc32Update(crc, (const unsigned char*)header, offsetof(TELEMETRY_RECORD_HEADER, crc));
+	crc = Crc32Update(crc, data, header->length);
+	return ~crc;
+}
+
+static void SegmentPath(const TELEMETRY_STORE* store, uint32_t sequence, char* path, size_t size)
+{
+	snprintf(path, size, "%s/%08x.seg", store->config.directory, sequence);
+}
+
+static int OpenSegment(const TELEMETRY_STORE* store, uint32_t sequence, int flags)
+{
+	char path[TELEMETRY_STORE_PATH_SIZE + 16];
+	int fd;
+
+	SegmentPath(store, sequence, path, sizeof(path));
+	if ((fd = open(path, flags | O_CLOEXEC, 0644)) < 0)
+	{
+		printf("Cannot open telemetry store segment %s: %s\n", path, strerror(errno));
+	}
+
+	return fd;
+}
+
+// SyncDirectory makes a created or deleted segment survive a power cut.
+static void SyncDirectory(const TELEMETRY_STORE* store)
+{
+	int fd;
+
+	if ((fd = open(store->config.directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) >= 0)
+	{
+		(void)fsync(fd);
+		close(fd);
+	}
+}
+
+//
+// ReadRecord reads and checks the record at offset, leaving the message in store->readBuffer.
+// Returns the record size, 0 at the end of the valid records.
+//
+static size_t ReadRecord(TELEMETRY_STORE* store, int fd, size_t offset, size_t end, TELEMETRY_RECORD_HEADER* header)
+{
+	size_t maxLength = store->config.segmentBytes - sizeof(TELEMETRY_RECORD_HEADER);
+
+	if (end - offset < sizeof(TELEMETRY_RECORD_HEADER) ||
+		pread(fd, header, sizeof(TELEMETRY_RECORD_HEADER), offset) != sizeof(TELEMETRY_RECORD_HEADER) ||
+		header->magic != TELEMETRY_STORE_MAGIC ||
+		header->length > maxLength ||
+		header->length > end - offset - sizeof(TELEMETRY_RECORD_HEADER) ||
+		pread(fd, store->readBuffer, header->length, offset + sizeof(TELEMETRY_RECORD_HEADER)) != (ssize_t)header->length ||
+		RecordCrc(header, store->readBuffer) != header->crc)
+	{
+		return 0;
+	}
+
+	return sizeof(TELEMETRY_RECORD_HEADER) + header->length;
+}
+
+//
+// RecoverSegment counts the valid records of a segment left by an earlier run.  The first bad record ends it:
+// in the newest segment that is where a power cut interrupted an append, and the file is truncated there.
+//
+static bool RecoverSegment(TELEMETRY_STORE* store, TELEMETRY_SEGMENT* segment, bool newest)
+{
+	TELEMETRY_RECORD_HEADER header;
+	struct stat st;
+	size_t recordLength, fileSize, size;
+	int fd;
+
+	if ((fd = OpenSegment(store, segment->sequence, O_RDWR)) < 0)
+	{
+		return false;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		printf("Cannot read the size of telemetry store segment %08x: %s\n", segment->sequence, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	fileSize = (size_t)st.st_size;
+	size = fileSize;
+	if (size > store->config.segmentBytes)
+	{
+		size = store->config.segmentBytes;
+	}
+
+	segment->length = 0;
+	segment->records = 0;
+	while ((recordLength = ReadRecord(store, fd, segment->length, size, &header)) > 0)
+	{
+		segment->length += recordLength;
+		segment->records++;
+	}
+
+	if (segment->length < fileSize)
+	{
+		printf("Telemetry store segment %08x: %zu bytes after the last valid record\n", segment->sequence, fileSize - segment->length);
+		store->stats.corrupt++;
+		if (newest)
+		{
+			(void)ftruncate(fd, segment->length);
+		}
+	}
+
+	close(fd);
+	return true;
+}
+
+static int CompareSequence(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// RemoveOldest deletes segments[0], read or not.
+static void RemoveOldest(TELEMETRY_STORE* store)
+{
+	char path[TELEMETRY_STORE_PATH_SIZE + 16];
+
+	if (store->readFd >= 0)
+	{
+		close(store->readFd);
+		store->readFd = -1;
+	}
+
+	SegmentPath(store, store->segments[0].sequence, path, sizeof(path));
+	(void)unlink(path);
+	SyncDirectory(store);
+
+	store->stats.bytes -= store->segments[0].length;
+	store->count--;
+	memmove(&store->segments[0], &store->segments[1], store->count * sizeof(TELEMETRY_SEGMENT));
+	store->readOffset = 0;
+	store->readRecords = 0;
+	store->peekLength = 0;
+}
+
+static void EvictOldest(TELEMETRY_STORE* store)
+{
+	uint32_t unread = store->segments[0].records - store->readRecords;
+
+	printf("Telemetry store full, %u stored messages evicted\n", unread);
+	store->stats.evicted += unread;
+	store->stats.records -= unread;
+	RemoveOldest(store);
+}
+
+static void Sync(TELEMETRY_STORE* store)
+{
+	size_t page = store->config.pageBytes;
+
+	if (store->dirtyEnd > store->dirtyStart)
+	{
+		(void)fdatasync(store->writeFd);
+		// a page partly written before is programmed again in full
+		store->stats.pagesProgrammed += (uint32_t)((store->dirtyEnd - 1) / page - store->dirtyStart / page + 1);
+		store->stats.syncs++;
+		store->dirtyStart = store->dirtyEnd;
+	}
+}
+
+// StartSegment closes the write segment and appends a new, empty one.
+static bool StartSegment(TELEMETRY_STORE* store)
+{
+	uint32_t sequence = store->count > 0 ? store->segments[store->count - 1].sequence + 1 : 1;
+	int fd;
+
+	if (store->count == TELEMETRY_STORE_MAX_SEGMENTS)
+	{
+		return false;
+	}
+
+	if ((fd = OpenSegment(store, sequence, O_WRONLY | O_CREAT | O_TRUNC)) < 0)
+	{
+		return false;
+	}
+	SyncDirectory(store);
+
+	if (store->writeFd >= 0)
+	{
+		Sync(store);
+		close(store->writeFd);
+	}
+
+	store->writeFd = fd;
+	store->dirtyStart = 0;
+	store->dirtyEnd = 0;
+	store->segments[store->count].sequence = sequence;
+	store->segments[store->count].length = 0;
+	store->segments[store->count].records = 0;
+	store->count++;
+	return true;
+}
+
+static bool ParseSize(const char* value, size_t* result)
+{
+	char* end;
+	unsigned long number = strtoul(value, &end, 0);
+
+	if (*end != '\0' || end == value)
+	{
+		return false;
+	}
+
+	*result = number;
+	return true;
+}
+
+bool TelemetryStore_ParseConfig(TELEMETRY_STORE_CONFIG* config, const char* settings)
+{
+	char key[16], value[TELEMETRY_STORE_PATH_SIZE];
+	size_t number = 0;
+	int consumed;
+	bool result;
+
+	while (settings != NULL && *settings != '\0')
+	{
+		if (sscanf(settings, "%15[^=]=%127[^,]%n", key, value, &consumed) != 2)
+		{
+			printf("Bad telemetry store setting '%s'\n", settings);
+			return false;
+		}
+
+		if (strcmp(key, "dir") == 0)
+		{
+			strcpy(config->directory, value);
+			result = true;
+		}
+		else if (strcmp(key, "evict") == 0)
+		{
+			result = strcmp(value, "oldest") == 0 || strcmp(value, "newest") == 0;
+			config->eviction = strcmp(value, "newest") == 0 ? TELEMETRY_STORE_EVICT_NEWEST : TELEMETRY_STORE_EVICT_OLDEST;
+		}
+		else if (ParseSize(value, &number) == false)
+		{
+			result = false;
+		}
+		else if (strcmp(key, "size") == 0)
+		{
+			config->maxBytes = number;
+			result = true;
+		}
+		else if (strcmp(key, "segment") == 0)
+		{
+			config->segmentBytes = number;
+			result = true;
+		}
+		else if (strcmp(key, "page") == 0 && number > 0)
+		{
+			config->pageBytes = number;
+			result = true;
+		}
+		else if (strcmp(key, "sync") == 0)
+		{
+			config->syncMs = (unsigned int)number;
+			result = true;
+		}
+		else if (strcmp(key, "rate") == 0 && number > 0)
+		{
+			config->replayPerSecond = (unsigned int)number;
+			result = true;
+		}
+		else
+		{
+			result = false;
+		}
+
+		if (result == false)
+		{
+			printf("Bad telemetry store setting '%s'\n", settings);
+			return false;
+		}
+
+		settings += consumed;
+		if (*settings == ',')
+		{
+			settings++;
+		}
+	}
+
+	// Whole pages per segment, and room for the write segment next to a full one.
+	if (config->segmentBytes < config->pageBytes || config->segmentBytes % config->pageBytes != 0 ||
+		config->maxBytes < 2 * config->segmentBytes || config->maxBytes / config->segmentBytes >= TELEMETRY_STORE_MAX_SEGMENTS)
+	{
+		printf("Telemetry store size %zu does not fit segments of %zu bytes\n", config->maxBytes, config->segmentBytes);
+		return false;
+	}
+
+	return true;
+}
+
+TELEMETRY_STORE_HANDLE TelemetryStore_Open(const TELEMETRY_STORE_CONFIG* config)
+{
+	uint32_t sequences[TELEMETRY_STORE_MAX_SEGMENTS];
+	TELEMETRY_STORE* store;
+	struct dirent* entry;
+	DIR* directory;
+	size_t found = 0, i;
+	uint32_t sequence;
+	int consumed;
+
+	if ((store = (TELEMETRY_STORE*)calloc(1, sizeof(TELEMETRY_STORE))) == NULL ||
+		(store->readBuffer = (unsigned char*)malloc(config->segmentBytes)) == NULL)
+	{
+		printf("Unable to allocate telemetry store");
+		free(store);
+		return NULL;
+	}
+
+	store->config = *config;
+	store->writeFd = -1;
+	store->readFd = -1;
+
+	if (mkdir(config->directory, 0755) < 0 && errno != EEXIST)
+	{
+		printf("Cannot create telemetry store %s: %s\n", config->directory, strerror(errno));
+		TelemetryStore_Close(store);
+		return NULL;
+	}
+
+	if ((directory = opendir(config->directory)) == NULL)
+	{
+		printf("Cannot read telemetry store %s: %s\n", config->directory, strerror(errno));
+		TelemetryStore_Close(store);
+		return NULL;
+	}
+
+	while ((entry = readdir(directory)) != NULL)
+	{
+		if (sscanf(entry->d_name, "%8x.seg%n", &sequence, &consumed) == 1 && consumed == 12 && entry->d_name[12] == '\0')
+		{
+			if (found < TELEMETRY_STORE_MAX_SEGMENTS)
+			{
+				sequences[found++] = sequence;
+			}
+			else
+			{
+				printf("Telemetry store: ignoring segment %s\n", entry->d_name);
+			}
+		}
+	}
+	closedir(directory);
+
+	qsort(sequences, found, sizeof(sequences[0]), CompareSequence);
+
+	for (i = 0; i < found; i++)
+	{
+		store->segments[store->count].sequence = sequences[i];
+		if (RecoverSegment(store, &store->segments[store->count], i == found - 1))
+		{
+			store->stats.records += store->segments[store->count].records;
+			store->stats.bytes += store->segments[store->count].length;
+			store->count++;
+		}
+	}
+
+	// Appends go to the newest segment that was found, or to a new one.
+	if (store->count > 0 && (store->writeFd = OpenSegment(store, store->segments[store->count - 1].sequence, O_WRONLY)) >= 0)
+	{
+		store->dirtyStart = store->segments[store->count - 1].length;
+		store->dirtyEnd = store->dirtyStart;
+	}
+	else if (StartSegment(store) == false)
+	{
+		TelemetryStore_Close(store);
+		return NULL;
+	}
+
+	// The size cap may have been lowered since the segments were written.
+	while (store->stats.bytes > config->maxBytes && store->count > 1)
+	{
+		EvictOldest(store);
+	}
+
+	if (store->stats.records > 0)
+	{
+		printf("Telemetry store %s: %u messages, %zu bytes to send\n", config->directory, store->stats.records, store->stats.bytes);
+	}
+
+	return store;
+}
+
+void TelemetryStore_Close(TELEMETRY_STORE_HANDLE storeHandle)
+{
+	if (storeHandle != NULL)
+	{
+		if (storeHandle->writeFd >= 0)
+		{
+			Sync(storeHandle);
+			close(storeHandle->writeFd);
+		}
+		if (storeHandle->readFd >= 0)
+		{
+			close(storeHandle->readFd);
+		}
+		free(storeHandle->readBuffer);
+		free(storeHandle);
+	}
+}
+
+bool TelemetryStore_Append(TELEMETRY_STORE_HANDLE storeHandle, const unsigned char* data, size_t length, uint8_t encoding)
+{
+	TELEMETRY_RECORD_HEADER header;
+	TELEMETRY_SEGMENT* segment;
+	struct iovec iov[2];
+	size_t total = sizeof(header) + length;
+
+	if (total > storeHandle->config.segmentBytes)
+	{
+		printf("Telemetry message of %zu bytes does not fit a store segment\n", length);
+		storeHandle->stats.refused++;
+		return false;
+	}
+
+	// Make room: the eviction policy decides between the oldest stored messages and this one.
+	while (storeHandle->stats.bytes + total > storeHandle->config.maxBytes)
+	{
+		if (storeHandle->config.eviction == TELEMETRY_STORE_EVICT_NEWEST || storeHandle->count == 1)
+		{
+			storeHandle->stats.refused++;
+			return false;
+		}
+		EvictOldest(storeHandle);
+	}
+
+	segment = &storeHandle->segments[storeHandle->count - 1];
+	if (segment->length + total > storeHandle->config.segmentBytes)
+	{
+		if (storeHandle->count == TELEMETRY_STORE_MAX_SEGMENTS && storeHandle->config.eviction == TELEMETRY_STORE_EVICT_OLDEST)
+		{
+			EvictOldest(storeHandle);
+		}
+		if (StartSegment(storeHandle) == false)
+		{
+			storeHandle->stats.refused++;
+			return false;
+		}
+		segment = &storeHandle->segments[storeHandle->count - 1];
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TELEMETRY_STORE_MAGIC;
+	header.length = (uint32_t)length;
+	header.encoding = encoding;
+	header.crc = RecordCrc(&header, data);
+
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = (void*)data;
+	iov[1].iov_len = length;
+
+	// A short write is overwritten by the next append, and ends the segment when recovering.
+	if (pwritev(storeHandle->writeFd, iov, 2, segment->length) != (ssize_t)total)
+	{
+		printf("Cannot write telemetry store segment %08x: %s\n", segment->sequence, strerror(errno));
+		storeHandle->stats.refused++;
+		return false;
+	}
+
+	if (storeHandle->dirtyEnd == storeHandle->dirtyStart)
+	{
+		storeHandle->dirtySinceMs = GetTimeMs();
+	}
+	segment->length += total;
+	segment->records++;
+	storeHandle->dirtyEnd = segment->length;
+
+	storeHandle->stats.appended++;
+	storeHandle->stats.records++;
+	storeHandle->stats.bytes += total;
+	storeHandle->stats.payloadBytes += length;
+	storeHandle->stats.writtenBytes += total;
+
+	if (storeHandle->config.syncMs == 0)
+	{
+		Sync(storeHandle);
+	}
+
+	return true;
+}
+
+bool TelemetryStore_Peek(TELEMETRY_STORE_HANDLE storeHandle, const unsigned char** data, size_t* length, uint8_t* encoding)
+{
+	TELEMETRY_RECORD_HEADER header;
+	TELEMETRY_SEGMENT* segment;
+	uint32_t skipped;
+
+	while (storeHandle->stats.records > 0)
+	{
+		segment = &storeHandle->segments[0];
+
+		// Fully read segments other than the write segment are deleted.
+		if (storeHandle->readOffset >= segment->length)
+		{
+			if (storeHandle->count == 1)
+			{
+				break;
+			}
+			RemoveOldest(storeHandle);
+			continue;
+		}
+
+		if (storeHandle->readFd < 0 && (storeHandle->readFd = OpenSegment(storeHandle, segment->sequence, O_RDONLY)) < 0)
+		{
+			return false;
+		}
+
+		if ((storeHandle->peekLength = ReadRecord(storeHandle, storeHandle->readFd, storeHandle->readOffset, segment->length, &header)) > 0)
+		{
+			*data = storeHandle->readBuffer;
+			*length = header.length;
+			*encoding = header.encoding;
+			return true;
+		}
+
+		// Damaged since it was written: give up on the rest of this segment.
+		skipped = segment->records - storeHandle->readRecords;
+		printf("Telemetry store segment %08x is damaged, %u messages lost\n", segment->sequence, skipped);
+		storeHandle->stats.corrupt++;
+		storeHandle->stats.records -= skipped;
+		storeHandle->readRecords = segment->records;
+		storeHandle->readOffset = segment->length;
+	}
+
+	return false;
+}
+
+void TelemetryStore_Remove(TELEMETRY_STORE_HANDLE storeHandle)
+{
+	if (storeHandle->peekLength == 0)
+	{
+		return;
+	}
+
+	storeHandle->readOffset += storeHandle->peekLength;
+	storeHandle->readRecords++;
+	storeHandle->peekLength = 0;
+	storeHandle->stats.removed++;
+	storeHandle->stats.records--;
+
+	if (storeHandle->readOffset >= storeHandle->segments[0].length)
+	{
+		// When everything was read the appends move to a new segment, so that this one can go as well.
+		if (storeHandle->count > 1 || StartSegment(storeHandle))
+		{
+			RemoveOldest(storeHandle);
+		}
+	}
+}
+
+void TelemetryStore_DoWork(TELEMETRY_STORE_HANDLE storeHandle)
+{
+	if (storeHandle->dirtyEnd > storeHandle->dirtyStart && GetTimeMs() - storeHandle->dirtySinceMs >= storeHandle->config.syncMs)
+	{
+		Sync(storeHandle);
+	}
+}
+
+unsigned int TelemetryStore_GetReplayRate(TELEMETRY_STORE_HANDLE storeHandle)
+{
+	return storeHandle->config.replayPerSecond;
+}
+
+void TelemetryStore_GetStats(TELEMETRY_STORE_HANDLE storeHandle, TELEMETRY_STORE_STATS* stats)
+{
+	*stats = storeHandle->stats;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AZURE_STORE_H
+#define AZURE_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_STORE_PATH_SIZE 128
+
+// Segment files a store may hold, the size cap divided by the segment size must stay below this.
+#define TELEMETRY_STORE_MAX_SEGMENTS 64
+
+// Encoding of a telemetry message body, kept with each stored message.
+typedef enum TELEMETRY_ENCODING_TAG
+{
+	// {"t":<epoch ms>,"r":[{"dt":<ms>,"<field>":<value>,...},...]} with the fields at their scale, e.g. 31.50
+	TELEMETRY_ENCODING_JSON,
+	// {0:<epoch ms>,1:[[<stream>,<dt ms>,<field>,...],...]} with integer keys and the fields as scaled integers, e.g. 3150
+	TELEMETRY_ENCODING_CBOR,
+	TELEMETRY_ENCODING_COUNT
+}
+TELEMETRY_ENCODING;
+
+typedef enum TELEMETRY_STORE_EVICTION_TAG
+{
+	// Delete the oldest segment to make room for a new message.
+	TELEMETRY_STORE_EVICT_OLDEST,
+	// Keep what is stored and refuse new messages.
+	TELEMETRY_STORE_EVICT_NEWEST
+}
+TELEMETRY_STORE_EVICTION;
+
+typedef struct TELEMETRY_STORE_CONFIG_TAG
+{
+	// Directory holding the segment files, created if missing.
+	char directory[TELEMETRY_STORE_PATH_SIZE];
+	// Cap on all segments together, record headers included.
+	size_t maxBytes;
+	// Size at which a segment is closed and a new one started, a multiple of pageBytes.
+	size_t segmentBytes;
+	// Program page of the flash, only used to account the write amplification.
+	size_t pageBytes;
+	TELEMETRY_STORE_EVICTION eviction;
+	// Longest time an appended message may wait for fdatasync; 0 syncs every append.
+	unsigned int syncMs;
+	// Stored messages sent per second once the hub is reachable again.
+	unsigned int replayPerSecond;
+}
+TELEMETRY_STORE_CONFIG;
+
+#define TELEMETRY_STORE_CONFIG_DEFAULT { "/var/lib/hrc/telemetry", 1024 * 1024, 64 * 1024, 4096, TELEMETRY_STORE_EVICT_OLDEST, 0, 5 }
+
+typedef struct TELEMETRY_STORE_STATS_TAG
+{
+	// Messages appended and taken out again.
+	uint32_t appended;
+	uint32_t removed;
+	// Messages deleted by the eviction policy or refused because the store was full.
+	uint32_t evicted;
+	uint32_t refused;
+	// Damaged or torn records found when opening or reading; the rest of such a record's segment is lost.
+	uint32_t corrupt;
+	// Messages waiting, and their size with headers.
+	uint32_t records;
+	size_t bytes;
+	// Message bytes appended, bytes written with the record headers, and flash pages the syncs programmed.
+	// pagesProgrammed * pageBytes / payloadBytes is the write amplification seen by the flash.
+	uint64_t payloadBytes;
+	uint64_t writtenBytes;
+	uint32_t pagesProgrammed;
+	uint32_t syncs;
+}
+TELEMETRY_STORE_STATS;
+
+//
+// Handle to an append-only queue of telemetry messages on flash.
+//
+typedef struct TELEMETRY_STORE_TAG* TELEMETRY_STORE_HANDLE;
+
+//
+// TelemetryStore_ParseConfig reads "dir=/data/queue,size=1048576,segment=65536,page=4096,evict=oldest,sync=0,rate=5"
+// into config; omitted keys keep their value.
+//
+bool TelemetryStore_ParseConfig(TELEMETRY_STORE_CONFIG* config, const char* settings);
+
+//
+// TelemetryStore_Open recovers the messages left in config->directory and opens it for appending.
+// A record torn by a power cut ends its segment; the newest segment is truncated before it.
+//
+TELEMETRY_STORE_HANDLE TelemetryStore_Open(const TELEMETRY_STORE_CONFIG* config);
+
+//
+// TelemetryStore_Close syncs outstanding appends and closes the files; stored messages stay for the next open.
+//
+void TelemetryStore_Close(TELEMETRY_STORE_HANDLE storeHandle);
+
+//
+// TelemetryStore_Append queues one message body with its encoding (a TELEMETRY_ENCODING value).
+// Returns false when the eviction policy refused it or the write failed.
+//
+bool TelemetryStore_Append(TELEMETRY_STORE_HANDLE storeHandle, const unsigned char* data, size_t length, uint8_t encoding);
+
+//
+// TelemetryStore_Peek points data at the oldest message, valid until the next call; false when the store is empty.
+// The message stays queued until TelemetryStore_Remove.
+//
+bool TelemetryStore_Peek(TELEMETRY_STORE_HANDLE storeHandle, const unsigned char** data, size_t* length, uint8_t* encoding);
+
+//
+// TelemetryStore_Remove drops the message returned by the last TelemetryStore_Peek.
+// Space is given back a segment at a time, a restart may send up to one segment again.
+//
+void TelemetryStore_Remove(TELEMETRY_STORE_HANDLE storeHandle);
+
+//
+// TelemetryStore_DoWork syncs appends older than config.syncMs. Call it from the main loop.
+//
+void TelemetryStore_DoWork(TELEMETRY_STORE_HANDLE storeHandle);
+
+unsigned int TelemetryStore_GetReplayRate(TELEMETRY_STORE_HANDLE storeHandle);
+
+void TelemetryStore_GetStats(TELEMETRY_STORE_HANDLE storeHandle, TELEMETRY_STORE_STATS* stats);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Write amplification of the telemetry store for each sync= setting. Built with "make store-bench":
+//   Azure_store_bench [settings] [messages] [intervalMs]
+// settings are TelemetryStore_ParseConfig keys applied to every run, e.g. "dir=/data/bench,page=2048"; without dir
+// a directory under /tmp is used, which says nothing about the time fdatasync takes on the target's flash.
+// Each run appends the same mix of batch bodies, one every intervalMs, reads them back and checks every byte.
+// Exits with 1 when a message does not come back as appended.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Azure_store.h"
+
+#define STORE_BENCH_MESSAGES 250
+#define STORE_BENCH_INTERVAL_MS 20
+
+// Sizes of the batch bodies the store takes while the hub is unreachable: full and age-flushed JSON and CBOR
+// messages at the TELEMETRY_BATCH_CONFIG_DEFAULT limits.
+static const struct
+{
+	size_t length;
+	uint8_t encoding;
+}
+storeBenchMix[] =
+{
+	{ 1010, TELEMETRY_ENCODING_JSON },
+	{ 1016, TELEMETRY_ENCODING_JSON },
+	{ 236, TELEMETRY_ENCODING_JSON },
+	{ 412, TELEMETRY_ENCODING_CBOR },
+	{ 405, TELEMETRY_ENCODING_CBOR },
+	{ 97, TELEMETRY_ENCODING_CBOR }
+};
+
+#define STORE_BENCH_MIX (sizeof(storeBenchMix) / sizeof(storeBenchMix[0]))
+
+static const unsigned int storeBenchSyncMs[] = { 0, 20, 100, 500, 2000 };
+
+static uint64_t GetTimeUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//
+// FillMessage writes the body of message number into data, different for every message.
+//
+static size_t FillMessage(uint32_t number, unsigned char* data, uint8_t* encoding)
+{
+	size_t length = storeBenchMix[number % STORE_BENCH_MIX].length;
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		data[i] = (unsigned char)(number * 131 + i * 7);
+	}
+
+	*encoding = storeBenchMix[number % STORE_BENCH_MIX].encoding;
+	return length;
+}
+
+//
+// RemoveSegments deletes the segment files a run left in directory.
+//
+static void RemoveSegments(const char* directory)
+{
+	// d_name holds up to 255 bytes
+	char path[TELEMETRY_STORE_PATH_SIZE + 257];
+	struct dirent* entry;
+	DIR* dir;
+
+	if ((dir = opendir(directory)) == NULL)
+	{
+		return;
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strstr(entry->d_name, ".seg") != NULL)
+		{
+			snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+			(void)unlink(path);
+		}
+	}
+	closedir(dir);
+}
+
+//
+// RunSync appends messages under one sync setting, reads them back and prints the accounting.
+//
+static bool RunSync(const TELEMETRY_STORE_CONFIG* base, unsigned int syncMs, uint32_t messages, unsigned int intervalMs)
+{
+	static unsigned char data[2048];
+	TELEMETRY_STORE_CONFIG config = *base;
+	TELEMETRY_STORE_HANDLE store;
+	TELEMETRY_STORE_STATS stats;
+	const unsigned char* stored;
+	uint64_t start, due, appendUs = 0;
+	uint32_t number;
+	size_t length, storedLength;
+	uint8_t encoding, storedEncoding;
+	bool result = true;
+
+	config.syncMs = syncMs;
+	if ((store = TelemetryStore_Open(&config)) == NULL)
+	{
+		return false;
+	}
+
+	TelemetryStore_GetStats(store, &stats);
+	if (stats.records > 0)
+	{
+		printf("%s holds %u messages, use an empty directory\n", config.directory, stats.records);
+		TelemetryStore_Close(store);
+		return false;
+	}
+
+	// appends paced as they come from the batch, with the main loop calling DoWork in between
+	due = GetTimeUs();
+	for (number = 0; number < messages; number++)
+	{
+		length = FillMessage(number, data, &encoding);
+		start = GetTimeUs();
+		if (TelemetryStore_Append(store, data, length, encoding) == false)
+		{
+			printf("sync=%u: message %u refused\n", syncMs, number);
+			result = false;
+		}
+		appendUs += GetTimeUs() - start;
+
+		due += (uint64_t)intervalMs * 1000;
+		do
+		{
+			TelemetryStore_DoWork(store);
+			usleep(1000);
+		}
+		while (GetTimeUs() < due);
+	}
+
+	// the last appends are synced by DoWork as well, before reading back can start a segment
+	due += (uint64_t)syncMs * 1000;
+	while (GetTimeUs() < due)
+	{
+		TelemetryStore_DoWork(store);
+		usleep(1000);
+	}
+	TelemetryStore_GetStats(store, &stats);
+
+	for (number = 0; result && number < messages; number++)
+	{
+		length = FillMessage(number, data, &encoding);
+		if (TelemetryStore_Peek(store, &stored, &storedLength, &storedEncoding) == false ||
+			storedLength != length || storedEncoding != encoding || memcmp(stored, data, length) != 0)
+		{
+			printf("sync=%u: message %u does not read back as appended\n", syncMs, number);
+			result = false;
+		}
+		TelemetryStore_Remove(store);
+	}
+
+	TelemetryStore_Close(store);
+	RemoveSegments(config.directory);
+
+	printf("%7u %8u %12llu %12llu %8u %8u %7.2f %7.2f %9.0f\n", syncMs, messages,
+		(unsigned long long)stats.payloadBytes, (unsigned long long)stats.writtenBytes, stats.syncs, stats.pagesProgrammed,
+		(double)stats.writtenBytes / stats.payloadBytes, (double)stats.pagesProgrammed * config.pageBytes / stats.payloadBytes,
+		(double)appendUs / messages);
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	TELEMETRY_STORE_CONFIG config = TELEMETRY_STORE_CONFIG_DEFAULT;
+	char temporary[] = "/tmp/store-bench.XXXXXX";
+	uint32_t messages = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : STORE_BENCH_MESSAGES;
+	unsigned int intervalMs = argc > 3 ? (unsigned int)strtoul(argv[3], NULL, 0) : STORE_BENCH_INTERVAL_MS;
+	bool created = false;
+	bool result = true;
+	size_t i;
+
+	if (mkdtemp(temporary) == NULL)
+	{
+		printf("Cannot create %s: %s\n", temporary, strerror(errno));
+		return 1;
+	}
+	strcpy(config.directory, temporary);
+
+	if (argc > 1 && TelemetryStore_ParseConfig(&config, argv[1]) == false)
+	{
+		rmdir(temporary);
+		return 1;
+	}
+
+	// the temporary directory only stays when settings named none
+	created = strcmp(config.directory, temporary) == 0;
+	if (created == false)
+	{
+		rmdir(temporary);
+	}
+
+	printf("%s, page %zu, segment %zu, %u messages every %u ms\n", config.directory, config.pageBytes, config.segmentBytes,
+		messages, intervalMs);
+	printf("%7s %8s %12s %12s %8s %8s %7s %7s %9s\n", "sync ms", "messages", "payload", "written", "syncs", "pages",
+		"headers", "WA", "append us");
+
+	for (i = 0; messages > 0 && i < sizeof(storeBenchSyncMs) / sizeof(storeBenchSyncMs[0]); i++)
+	{
+		if (RunSync(&config, storeBenchSyncMs[i], messages, intervalMs) == false)
+		{
+			result = false;
+			break;
+		}
+	}
+
+	if (created)
+	{
+		rmdir(temporary);
+	}
+
+	return result ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "HRC_driver.h"
+#include "HRC_irq.h"
+#include "HRC_acq.h"
+
+typedef struct {
+	pthread_t thread;
+	atomic_bool running;
+	HRC_DEVICE *dev;
+	HRC_ACQ_STATS stats;
+} HRC_ACQ;
+
+// one slot per device, taken by HRC_AcqStart until HRC_AcqStop
+static HRC_ACQ hrc_acq[HRC_MAX_DEVICES];
+
+static uint64_t HRC_AcqNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Time for an empty FIFO to fill up at the current sample rate, which the
+// drain may have switched (see HRC_RequestFormat)
+static uint64_t HRC_AcqFillTimeNs(const HRC_DEVICE *dev) {
+	return (uint64_t) HRC_FIFO_DEPTH * dev->drain.sample_ns;
+}
+
+static HRC_ACQ *HRC_AcqFind(const HRC_DEVICE *dev) {
+	uint32_t ix;
+
+	for (ix = 0; ix < HRC_MAX_DEVICES; ix++)
+		if (hrc_acq[ix].dev == dev)
+			return &hrc_acq[ix];
+	return NULL;
+}
+
+static void *HRC_AcqThread(void *arg) {
+	HRC_ACQ *acq = arg;
+	HRC_DEVICE *dev = acq->dev;
+	HRC_ACQ_STATS *stats = &acq->stats;
+	uint64_t deadline = HRC_AcqNowNs() + HRC_AcqFillTimeNs(dev);
+	uint64_t irq_ns, done_ns;
+	int rc, count;
+
+	while (atomic_load_explicit(&acq->running, memory_order_relaxed)) {
+		// without INT line sleep until the FIFO should hold HRC_DRAIN_TARGET samples
+		if (dev->irq.type == HRC_IRQ_POLL) {
+			usleep(HRC_DrainInterval(dev));
+			rc = 1;
+		} else {
+			rc = HRC_IrqWait(&dev->irq, dev, HRC_ACQ_WAIT_MS);
+		}
+		if (rc == 0)
+			continue;
+		if (rc < 0) {
+			stats->bus_errors++;
+			usleep(1000);
+			continue;
+		}
+
+		irq_ns = HRC_AcqNowNs();
+		count = HRC_Drain(dev);
+		done_ns = HRC_AcqNowNs();
+
+		if (count < 0) {
+			stats->bus_errors++;
+			continue;
+		}
+		if (count == 0)
+			continue;
+
+		stats->drains++;
+		stats->samples += count;
+		if ((done_ns - irq_ns) / 1000 > stats->max_drain_us)
+			stats->max_drain_us = (done_ns - irq_ns) / 1000;
+
+		if (dev->fifo.overflow || done_ns > deadline) {
+			stats->missed_deadlines++;
+			if (done_ns > deadline && (done_ns - deadline) / 1000 > stats->max_late_us)
+				stats->max_late_us = (done_ns - deadline) / 1000;
+		}
+
+		deadline = done_ns + HRC_AcqFillTimeNs(dev);
+	}
+
+	return NULL;
+}
+
+int HRC_AcqParseConfig(HRC_ACQ_CONFIG *cfg, const char *spec) {
+	char key[16];
+	long value;
+	int consumed;
+
+	while (spec != NULL && *spec) {
+		if (sscanf(spec, " %15[^=,]=%li%n", key, &value, &consumed) != 2) {
+			printf("HRC acq: cannot parse '%s'\n", spec);
+			return -1;
+		}
+
+		if (strcmp(key, "prio") == 0)
+			cfg->priority = (int) value;
+		else if (strcmp(key, "cpus") == 0)
+			cfg->cpus = (uint32_t) value;
+		else if (strcmp(key, "mlock") == 0)
+			cfg->lock_memory = value != 0;
+		else {
+			printf("HRC acq: unknown setting '%s'\n", key);
+			return -1;
+		}
+
+		spec += consumed;
+		if (*spec == ',')
+			spec++;
+	}
+
+	return 0;
+}
+
+int HRC_AcqStart(HRC_DEVICE *dev, const HRC_ACQ_CONFIG *cfg) {
+	pthread_attr_t attr;
+	struct sched_param param;
+	cpu_set_t cpus;
+	HRC_ACQ *acq;
+	int cpu, rc;
+
+	if (HRC_AcqFind(dev) != NULL)
+		return -1;
+	if ((acq = HRC_AcqFind(NULL)) == NULL) {
+		printf("HRC acq: no slot for %s\n", dev->name);
+		return -1;
+	}
+
+	// page faults on the drain path cost more than the FIFO has to spare
+	if (cfg->lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		printf("HRC acq: mlockall failed: %s\n", strerror(errno));
+
+	memset(&acq->stats, 0, sizeof(acq->stats));
+	acq->dev = dev;
+	atomic_store(&acq->running, true);
+
+	pthread_attr_init(&attr);
+
+	if (cfg->cpus) {
+		CPU_ZERO(&cpus);
+		for (cpu = 0; cpu < 32; cpu++)
+			if (cfg->cpus & (1u << cpu))
+				CPU_SET(cpu, &cpus);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+	}
+
+	if (cfg->priority > 0) {
+		param.sched_priority = cfg->priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	rc = pthread_create(&acq->thread, &attr, HRC_AcqThread, acq);
+	if (rc == EPERM && cfg->priority > 0) {
+		printf("HRC acq: no permission for SCHED_FIFO, using the default policy\n");
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		rc = pthread_create(&acq->thread, &attr, HRC_AcqThread, acq);
+	}
+
+	pthread_attr_destroy(&attr);
+
+	if (rc != 0) {
+		printf("HRC acq: cannot start thread for %s: %s\n", dev->name, strerror(rc));
+		atomic_store(&acq->running, false);
+		acq->dev = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+void HRC_AcqStop(void) {
+	uint32_t ix;
+
+	// signal all first, so the threads wind down in parallel
+	for (ix = 0; ix < HRC_MAX_DEVICES; ix++)
+		atomic_store(&hrc_acq[ix].running, false);
+
+	for (ix = 0; ix < HRC_MAX_DEVICES; ix++) {
+		if (hrc_acq[ix].dev == NULL)
+			continue;
+		pthread_join(hrc_acq[ix].thread, NULL);
+		hrc_acq[ix].dev = NULL;
+	}
+}
+
+bool HRC_AcqRunning(const HRC_DEVICE *dev) {
+	HRC_ACQ *acq = HRC_AcqFind(dev);
+
+	return acq != NULL && atomic_load(&acq->running);
+}
+
+bool HRC_AcqGetStats(const HRC_DEVICE *dev, HRC_ACQ_STATS *stats) {
+	HRC_ACQ *acq = HRC_AcqFind(dev);
+
+	if (acq == NULL) {
+		memset(stats, 0, sizeof(*stats));
+		return false;
+	}
+
+	*stats = acq->stats;
+	return true;
+}
@@ -0,0 +1,64 @@
+/* 
+ ** HRC acquisition thread
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_ACQ__
+#define __HRC_ACQ__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct HRC_DEVICE;
+
+// how long one wait for the INT source may block, bounds HRC_AcqStop latency
+#define HRC_ACQ_WAIT_MS      100
+
+typedef struct {
+	int priority;       // SCHED_FIFO priority, 0 keeps the default policy
+	uint32_t cpus;      // CPU affinity mask, 0 for no affinity
+	bool lock_memory;   // mlockall() before starting
+} HRC_ACQ_CONFIG;
+
+#define HRC_ACQ_CONFIG_DEFAULT { 0, 0, false }
+
+typedef struct {
+	uint32_t drains;            // FIFO drains with at least one sample
+	uint32_t samples;           // samples moved to the device ring
+	uint32_t bus_errors;        // drains that failed on the bus
+	uint32_t missed_deadlines;  // drains that ended after the FIFO could have filled, or found it overflowed
+	uint32_t max_late_us;       // worst overrun of the deadline
+	uint32_t max_drain_us;      // worst INT-to-drained latency
+} HRC_ACQ_STATS;
+
+// spec - comma separated settings, e.g. "prio=50,cpus=0x2,mlock=1"
+int HRC_AcqParseConfig(HRC_ACQ_CONFIG *cfg, const char *spec);
+
+// Starts a thread that waits on the INT source of dev and drains its FIFO into
+// its ring, one thread per device. Once started the thread is the only one reading the FIFO.
+int HRC_AcqStart(struct HRC_DEVICE *dev, const HRC_ACQ_CONFIG *cfg);
+// Stops the threads of all devices
+void HRC_AcqStop(void);
+bool HRC_AcqRunning(const struct HRC_DEVICE *dev);
+
+// Snapshot of the counters, fields are updated individually by the thread.
+// Returns false when no thread was started for dev.
+bool HRC_AcqGetStats(const struct HRC_DEVICE *dev, HRC_ACQ_STATS *stats);
+
+#endif
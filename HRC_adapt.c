@@ -0,0 +1,194 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "HRC_defines.h"
+#include "HRC_adapt.h"
+
+static const uint8_t hrc_adapt_ladder[HRC_ADAPT_LEVELS] = {
+	HRC_SAMPLES_50 | HRC_PULSE_WIDTH_1600,
+	HRC_SAMPLES_100 | HRC_PULSE_WIDTH_1600,
+	HRC_SAMPLES_200 | HRC_PULSE_WIDTH_800,
+	HRC_SAMPLES_400 | HRC_PULSE_WIDTH_400,
+};
+
+static const uint16_t hrc_adapt_rates[HRC_ADAPT_LEVELS] = { 50, 100, 200, 400 };
+
+uint16_t HRC_AdaptRate(uint8_t level) {
+	return hrc_adapt_rates[level < HRC_ADAPT_LEVELS ? level : HRC_ADAPT_LEVELS - 1];
+}
+
+// Highest level whose rate is not above rate, the lowest one for less
+static uint8_t HRC_AdaptLevel(long rate) {
+	uint8_t level = 0;
+
+	while (level + 1 < HRC_ADAPT_LEVELS && hrc_adapt_rates[level + 1] <= rate)
+		level++;
+	return level;
+}
+
+int HRC_AdaptParseConfig(HRC_ADAPT_CONFIG *cfg, const char *spec) {
+	char key[16];
+	long value;
+	int consumed;
+
+	if (spec != NULL && strcmp(spec, "off") == 0) {
+		cfg->enabled = false;
+		return 0;
+	}
+
+	while (spec != NULL && *spec) {
+		if (sscanf(spec, " %15[^=,]=%li%n", key, &value, &consumed) != 2 || value < 0) {
+			printf("HRC adapt: cannot parse '%s'\n", spec);
+			return -1;
+		}
+
+		if (strcmp(key, "min") == 0)
+			cfg->min_level = HRC_AdaptLevel(value);
+		else if (strcmp(key, "rest") == 0)
+			cfg->rest_level = HRC_AdaptLevel(value);
+		else if (strcmp(key, "max") == 0)
+			cfg->max_level = HRC_AdaptLevel(value);
+		else if (strcmp(key, "hold") == 0)
+			cfg->hold_ms = (uint32_t) value;
+		else if (strcmp(key, "settle") == 0)
+			cfg->settle_ms = (uint32_t) value;
+		else if (strcmp(key, "cpu") == 0)
+			cfg->cpu_permille = (uint32_t) value;
+		else if (strcmp(key, "fill") == 0)
+			cfg->ring_fill = (uint32_t) value;
+		else if (strcmp(key, "low") == 0 && value <= 100)
+			cfg->low = (uint8_t) value;
+		else if (strcmp(key, "high") == 0 && value <= 100)
+			cfg->high = (uint8_t) value;
+		else {
+			printf("HRC adapt: unknown setting '%s'\n", key);
+			return -1;
+		}
+
+		spec += consumed;
+		if (*spec == ',')
+			spec++;
+	}
+
+	if (cfg->min_level > cfg->rest_level || cfg->rest_level > cfg->max_level || cfg->low > cfg->high) {
+		printf("HRC adapt: needs min <= rest <= max and low <= high\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void HRC_AdaptInit(HRC_ADAPT *adapt, const HRC_ADAPT_CONFIG *cfg, uint8_t spo2_config) {
+	static const uint16_t rates[8] = { 50, 100, 167, 200, 400, 600, 800, 1000 };
+
+	memset(adapt, 0, sizeof(*adapt));
+	adapt->cfg = *cfg;
+	adapt->level = HRC_AdaptLevel(rates[(spo2_config & HRC_SAMPLES_MASK) >> 2]);
+	adapt->reason = "start";
+
+	// a sensor started outside the limits is switched by the first update
+	if (adapt->level < cfg->min_level) {
+		adapt->level = cfg->min_level;
+		adapt->raises++;
+	} else if (adapt->level > cfg->max_level) {
+		adapt->level = cfg->max_level;
+		adapt->lowers++;
+	} else {
+		return;
+	}
+	adapt->reason = "limits";
+	adapt->pending = true;
+}
+
+int HRC_AdaptUpdate(HRC_ADAPT *adapt, const HRC_ADAPT_INPUT *input, uint64_t now_ns) {
+	const HRC_ADAPT_CONFIG *cfg = &adapt->cfg;
+	uint8_t level = adapt->level;
+	uint64_t since_ms;
+	bool load;
+
+	// the estimators are still warming up on the first call
+	if (adapt->changed_ns == 0)
+		adapt->changed_ns = now_ns;
+	since_ms = (now_ns - adapt->changed_ns) / 1000000;
+
+	if (adapt->pending) {
+		adapt->pending = false;
+		adapt->last = *input;
+		return hrc_adapt_ladder[level];
+	}
+
+	load = input->cpu_permille > cfg->cpu_permille || input->ring_fill > cfg->ring_fill ||
+			input->ring_drops != adapt->last.ring_drops || input->uplink_drops != adapt->last.uplink_drops;
+	adapt->last = *input;
+
+	if (input->confidence == 0 || input->confidence >= cfg->high) {
+		if (adapt->quiet_ns == 0)
+			adapt->quiet_ns = now_ns;
+	} else {
+		adapt->quiet_ns = 0;
+	}
+
+	if (load) {
+		adapt->calm_ns = 0;
+		if (level > cfg->min_level && since_ms >= HRC_ADAPT_PRESSURE_HOLD_MS) {
+			level--;
+			adapt->reason = "load";
+		}
+	} else {
+		if (adapt->calm_ns == 0)
+			adapt->calm_ns = now_ns;
+
+		if (since_ms < cfg->hold_ms) {
+			// the estimators settle on the new format
+		} else if (input->confidence && input->confidence < cfg->low) {
+			if (level < cfg->max_level) {
+				level++;
+				adapt->reason = "poor signal";
+			}
+		} else if (level < cfg->rest_level) {
+			if ((now_ns - adapt->calm_ns) / 1000000 >= cfg->settle_ms) {
+				level++;
+				adapt->reason = "load gone";
+			}
+		} else if (level > cfg->rest_level && adapt->quiet_ns) {
+			if ((now_ns - adapt->quiet_ns) / 1000000 >= cfg->settle_ms) {
+				level--;
+				adapt->reason = input->confidence ? "good signal" : "no pulse";
+			}
+		}
+	}
+
+	if (level == adapt->level)
+		return -1;
+
+	if (level > adapt->level)
+		adapt->raises++;
+	else
+		adapt->lowers++;
+	adapt->level = level;
+	adapt->changed_ns = now_ns;
+	// each condition is seen anew at the new level
+	adapt->quiet_ns = 0;
+	adapt->calm_ns = load ? 0 : now_ns;
+
+	return hrc_adapt_ladder[level];
+}
@@ -0,0 +1,94 @@
+/*
+ ** Sample rate and pulse width controller
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_ADAPT__
+#define __HRC_ADAPT__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HRC_ring.h"
+
+// Moves one sensor along a ladder of formats, each the longest pulse width,
+// i.e. the highest resolution, the sensor allows at its rate in SpO2 mode:
+//   50 sps 16 bit, 100 sps 16 bit, 200 sps 15 bit, 400 sps 14 bit
+// Down one step under load: CPU, ring fill, ring drops, uplink drops.
+// Up one step while a pulse is seen with poor confidence.
+// Down towards the rest level while the confidence is good or no pulse is
+// seen at all, and back up to it once the load is gone.
+// Every level runs the heart rate estimator at the same internal rate, so a
+// step carries on without restarting it (see HRC_HrSetRate).
+
+#define HRC_ADAPT_LEVELS          4
+#define HRC_ADAPT_PRESSURE_HOLD_MS 2000  // least time between two steps down under load
+
+typedef struct {
+	bool enabled;
+	uint8_t min_level;       // indexes into the ladder
+	uint8_t rest_level;
+	uint8_t max_level;
+	uint32_t hold_ms;        // least time between two steps on confidence
+	uint32_t settle_ms;      // how long a condition lasts before stepping towards rest
+	uint32_t cpu_permille;   // process CPU of one core counted as load
+	uint32_t ring_fill;      // samples waiting in the ring counted as load
+	uint8_t low;             // confidence below which a pulse is poor
+	uint8_t high;            // and from which it is good
+} HRC_ADAPT_CONFIG;
+
+#define HRC_ADAPT_CONFIG_DEFAULT { true, 0, 1, 3, 10000, 30000, 700, HRC_RING_CAPACITY / 2, 50, 80 }
+
+// What one decision goes by
+typedef struct {
+	uint8_t confidence;      // of the heart rate, 0 while no pulse is seen
+	uint32_t cpu_permille;   // of one core, the whole process
+	uint32_t ring_fill;      // samples waiting in the device ring
+	uint32_t ring_drops;     // samples the ring dropped, total
+	uint32_t uplink_drops;   // telemetry records and waveform blocks dropped or put off, total
+} HRC_ADAPT_INPUT;
+
+typedef struct {
+	HRC_ADAPT_CONFIG cfg;
+	uint8_t level;
+	bool pending;            // level clamped by HRC_AdaptInit, the sensor is not there yet
+	uint64_t changed_ns;     // CLOCK_MONOTONIC of the last step, or of the first update
+	uint64_t quiet_ns;       // since when the confidence is good or no pulse is seen, 0 when not
+	uint64_t calm_ns;        // since when there is no load, 0 when there is
+	HRC_ADAPT_INPUT last;    // for the totals
+	const char *reason;      // of the last step
+	uint32_t raises;
+	uint32_t lowers;
+} HRC_ADAPT;
+
+// spec - "off", or comma separated settings, e.g. "min=50,rest=100,max=400,hold=10000,settle=30000,cpu=700,fill=512,low=50,high=80";
+//        min, rest and max are rates in sps, each taking the highest ladder level not above it
+int HRC_AdaptParseConfig(HRC_ADAPT_CONFIG *cfg, const char *spec);
+
+// spo2_config - the sensor's current SPO2_CONFIG, the ladder level of the highest rate not above it is taken,
+//               within min and max; the first HRC_AdaptUpdate switches to a level that had to be clamped
+void HRC_AdaptInit(HRC_ADAPT *adapt, const HRC_ADAPT_CONFIG *cfg, uint8_t spo2_config);
+
+// Returns the SPO2_CONFIG fields (HRC_SAMPLES_* | HRC_PULSE_WIDTH_*) to switch to, or -1 to stay
+int HRC_AdaptUpdate(HRC_ADAPT *adapt, const HRC_ADAPT_INPUT *input, uint64_t now_ns);
+
+// Ladder level in samples per second
+uint16_t HRC_AdaptRate(uint8_t level);
+
+#endif
@@ -0,0 +1,115 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <malloc.h>
+
+#include "HRC_alloc.h"
+
+#ifdef HRC_ALLOC_COUNT
+
+// the acquisition thread may allocate too; 32 bit so armv5 needs no libatomic
+static atomic_uint allocs, frees, reallocs, live_bytes, peak_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void HRC_AllocAdd(void *ptr) {
+	unsigned int size = malloc_usable_size(ptr);
+	unsigned int live, peak;
+
+	live = atomic_fetch_add(&live_bytes, size) + size;
+	peak = atomic_load(&peak_bytes);
+	while (live > peak && !atomic_compare_exchange_weak(&peak_bytes, &peak, live))
+		;
+}
+
+static void HRC_AllocRemove(void *ptr) {
+	atomic_fetch_sub(&live_bytes, malloc_usable_size(ptr));
+}
+
+void *__wrap_malloc(size_t size) {
+	void *ptr = __real_malloc(size);
+
+	if (ptr) {
+		atomic_fetch_add(&allocs, 1);
+		HRC_AllocAdd(ptr);
+	}
+	return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+	void *ptr = __real_calloc(count, size);
+
+	if (ptr) {
+		atomic_fetch_add(&allocs, 1);
+		HRC_AllocAdd(ptr);
+	}
+	return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	size_t old = ptr ? malloc_usable_size(ptr) : 0;
+	void *result = __real_realloc(ptr, size);
+
+	if (ptr == NULL) {
+		if (result) {
+			atomic_fetch_add(&allocs, 1);
+			HRC_AllocAdd(result);
+		}
+	} else if (size == 0) {
+		atomic_fetch_add(&frees, 1);
+		atomic_fetch_sub(&live_bytes, old);
+	} else if (result) {
+		atomic_fetch_add(&reallocs, 1);
+		atomic_fetch_sub(&live_bytes, old);
+		HRC_AllocAdd(result);
+	}
+	return result;
+}
+
+void __wrap_free(void *ptr) {
+	if (ptr) {
+		atomic_fetch_add(&frees, 1);
+		HRC_AllocRemove(ptr);
+	}
+	__real_free(ptr);
+}
+
+bool HRC_AllocGetStats(HRC_ALLOC_STATS *stats) {
+	stats->allocs = atomic_load(&allocs);
+	stats->frees = atomic_load(&frees);
+	stats->reallocs = atomic_load(&reallocs);
+	stats->live_bytes = atomic_load(&live_bytes);
+	stats->peak_bytes = atomic_load(&peak_bytes);
+	return true;
+}
+
+#else
+
+bool HRC_AllocGetStats(HRC_ALLOC_STATS *stats) {
+	memset(stats, 0, sizeof(*stats));
+	return false;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/* 
+ ** Heap allocation counters
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_ALLOC__
+#define __HRC_ALLOC__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Built with HRC_ALLOC_COUNT (make ALLOC_COUNT=1), which also links with
+// -Wl,--wrap=malloc,... so every call from this program and the statically
+// linked SDK goes through the counters. Calls made inside shared libraries
+// are not seen.
+
+// Counters wrap at 2^32
+typedef struct {
+	uint32_t allocs;       // malloc, calloc and realloc(NULL, n)
+	uint32_t frees;        // free of non-NULL pointers and realloc(p, 0)
+	uint32_t reallocs;     // realloc of an existing block
+	uint32_t live_bytes;   // usable size of the blocks not freed
+	uint32_t peak_bytes;
+} HRC_ALLOC_STATS;
+
+// false when the program was built without the counters
+bool HRC_AllocGetStats(HRC_ALLOC_STATS *stats);
+
+#endif
@@ -0,0 +1,231 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "HRC_bus.h"
+
+// buses are added before the threads that use them start
+static HRC_BUS hrc_buses[HRC_BUS_MAX];
+static uint32_t hrc_bus_count;
+
+static const char *hrc_bus_class_names[HRC_BUS_CLASSES] = {
+	"drain", "config", "background",
+};
+
+static const uint32_t hrc_bus_slack_us[HRC_BUS_CLASSES] = {
+	HRC_BUS_DRAIN_SLACK_US, HRC_BUS_CONFIG_SLACK_US, HRC_BUS_BACKGROUND_SLACK_US,
+};
+
+uint64_t HRC_BusNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+const char *HRC_BusClassName(HRC_BUS_CLASS cls) {
+	return cls < HRC_BUS_CLASSES ? hrc_bus_class_names[cls] : "?";
+}
+
+HRC_BUS *HRC_BusGet(const char *name) {
+	HRC_BUS *bus;
+	uint32_t ix;
+
+	for (ix = 0; ix < hrc_bus_count; ix++)
+		if (strcmp(hrc_buses[ix].name, name) == 0)
+			return &hrc_buses[ix];
+
+	if (hrc_bus_count == HRC_BUS_MAX) {
+		printf("HRC bus: no room for '%s', its transactions are not scheduled\n", name);
+		return NULL;
+	}
+
+	bus = &hrc_buses[hrc_bus_count++];
+	memset(bus, 0, sizeof(*bus));
+	snprintf(bus->name, sizeof(bus->name), "%s", name);
+	pthread_mutex_init(&bus->lock, NULL);
+	pthread_cond_init(&bus->cond, NULL);
+
+	return bus;
+}
+
+// Ticket of the waiter to grant next: lowest class, then earliest deadline, then first come
+static uint32_t HRC_BusNext(const HRC_BUS *bus) {
+	uint32_t ix, best = 0;
+
+	for (ix = 1; ix < bus->waiting; ix++) {
+		if (bus->waiters[ix].cls != bus->waiters[best].cls) {
+			if (bus->waiters[ix].cls < bus->waiters[best].cls)
+				best = ix;
+		} else if (bus->waiters[ix].deadline_ns != bus->waiters[best].deadline_ns) {
+			if (bus->waiters[ix].deadline_ns < bus->waiters[best].deadline_ns)
+				best = ix;
+		} else if ((int32_t) (bus->waiters[ix].ticket - bus->waiters[best].ticket) < 0) {
+			best = ix;
+		}
+	}
+
+	return bus->waiters[best].ticket;
+}
+
+static void HRC_BusRemoveWaiter(HRC_BUS *bus, uint32_t ticket) {
+	uint32_t ix;
+
+	for (ix = 0; ix < bus->waiting; ix++) {
+		if (bus->waiters[ix].ticket == ticket) {
+			bus->waiters[ix] = bus->waiters[--bus->waiting];
+			return;
+		}
+	}
+}
+
+void HRC_BusLock(HRC_BUS *bus, HRC_BUS_CLASS cls, uint64_t deadline_ns) {
+	HRC_BUS_CLASS_STATS *stats;
+	uint64_t asked_ns, wait_us;
+	uint32_t ticket;
+	bool contended = false;
+
+	if (bus == NULL)
+		return;
+
+	asked_ns = HRC_BusNowNs();
+	if (deadline_ns == 0)
+		deadline_ns = asked_ns + hrc_bus_slack_us[cls] * 1000ULL;
+
+	pthread_mutex_lock(&bus->lock);
+
+	if (bus->depth && pthread_equal(bus->owner, pthread_self())) {
+		bus->depth++;
+		pthread_mutex_unlock(&bus->lock);
+		return;
+	}
+
+	if (bus->depth || bus->waiting) {
+		contended = true;
+		if (bus->waiting < HRC_BUS_MAX_WAITERS) {
+			ticket = bus->next_ticket++;
+			bus->waiters[bus->waiting].cls = cls;
+			bus->waiters[bus->waiting].deadline_ns = deadline_ns;
+			bus->waiters[bus->waiting].ticket = ticket;
+			bus->waiting++;
+
+			while (bus->depth || HRC_BusNext(bus) != ticket)
+				pthread_cond_wait(&bus->cond, &bus->lock);
+			HRC_BusRemoveWaiter(bus, ticket);
+		} else {
+			// more threads than slots, the extra ones just take the bus when free
+			while (bus->depth)
+				pthread_cond_wait(&bus->cond, &bus->lock);
+		}
+	}
+
+	bus->owner = pthread_self();
+	bus->depth = 1;
+	bus->owner_class = cls;
+	bus->start_ns = HRC_BusNowNs();
+	bus->job_bytes = 0;
+
+	if (bus->stats.since_ns == 0)
+		bus->stats.since_ns = asked_ns;
+
+	stats = &bus->stats.cls[cls];
+	stats->jobs++;
+	if (contended)
+		stats->contended++;
+	if (bus->start_ns > deadline_ns)
+		stats->late++;
+	wait_us = (bus->start_ns - asked_ns) / 1000;
+	if (wait_us > stats->max_wait_us)
+		stats->max_wait_us = wait_us;
+
+	pthread_mutex_unlock(&bus->lock);
+}
+
+void HRC_BusUnlock(HRC_BUS *bus, uint32_t bytes) {
+	HRC_BUS_CLASS_STATS *stats;
+
+	if (bus == NULL)
+		return;
+
+	pthread_mutex_lock(&bus->lock);
+
+	bus->job_bytes += bytes;
+	if (bus->depth && --bus->depth == 0) {
+		stats = &bus->stats.cls[bus->owner_class];
+		stats->busy_ns += HRC_BusNowNs() - bus->start_ns;
+		stats->bytes += bus->job_bytes;
+		if (bus->waiting)
+			pthread_cond_broadcast(&bus->cond);
+	}
+
+	pthread_mutex_unlock(&bus->lock);
+}
+
+void HRC_BusGetStats(HRC_BUS *bus, HRC_BUS_STATS *stats) {
+	pthread_mutex_lock(&bus->lock);
+	*stats = bus->stats;
+	pthread_mutex_unlock(&bus->lock);
+}
+
+// value per mille of total, printed as a percentage with one decimal
+static void HRC_BusPrintShare(const char *label, uint64_t value, uint64_t total) {
+	uint32_t permille = total ? value * 1000 / total : 0;
+
+	printf("%s%u.%u%%", label, permille / 10, permille % 10);
+}
+
+void HRC_BusDump(void) {
+	HRC_BUS_STATS stats;
+	HRC_BUS_CLASS_STATS *cls;
+	uint64_t elapsed_ns, busy_ns, bytes;
+	uint32_t ix, c;
+
+	printf("======== I2C buses: ======== \n");
+	for (ix = 0; ix < hrc_bus_count; ix++) {
+		HRC_BusGetStats(&hrc_buses[ix], &stats);
+		elapsed_ns = stats.since_ns ? HRC_BusNowNs() - stats.since_ns : 0;
+
+		busy_ns = 0;
+		bytes = 0;
+		for (c = 0; c < HRC_BUS_CLASSES; c++) {
+			busy_ns += stats.cls[c].busy_ns;
+			bytes += stats.cls[c].bytes;
+		}
+
+		// a byte takes 9 clocks with its acknowledge
+		printf("%-12s", hrc_buses[ix].name);
+		HRC_BusPrintShare(" held ", busy_ns, elapsed_ns);
+		HRC_BusPrintShare(", wire ", bytes * 9 * 1000000000ULL / HRC_BUS_CLOCK_HZ, elapsed_ns);
+		printf(" at %u kHz over %llu ms\n", HRC_BUS_CLOCK_HZ / 1000, (unsigned long long) (elapsed_ns / 1000000));
+
+		for (c = 0; c < HRC_BUS_CLASSES; c++) {
+			cls = &stats.cls[c];
+			printf("  %-10s %u jobs, %u contended, %u late, worst wait %u us, %llu bytes",
+					HRC_BusClassName(c), cls->jobs, cls->contended, cls->late, cls->max_wait_us,
+					(unsigned long long) cls->bytes);
+			HRC_BusPrintShare(", held ", cls->busy_ns, elapsed_ns);
+			printf("\n");
+		}
+	}
+	printf("============================= \n");
+}
@@ -0,0 +1,103 @@
+/*
+ ** Shared I2C bus: transactions of every sensor on one adapter, by class and deadline
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_BUS__
+#define __HRC_BUS__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define HRC_BUS_MAX          4
+#define HRC_BUS_MAX_WAITERS  16      // threads blocked on one bus at a time
+#define HRC_BUS_CLOCK_HZ     400000  // SCL assumed for the wire time estimate
+
+// A job holds the bus for one or more transactions. Waiting jobs are granted
+// by class first, then earliest deadline; a job that started is never preempted.
+typedef enum {
+	HRC_BUS_DRAIN,       // FIFO drain, due when the FIFO would overflow
+	HRC_BUS_CONFIG,      // configuration and identification registers
+	HRC_BUS_BACKGROUND,  // temperature, register dumps
+	HRC_BUS_CLASSES
+} HRC_BUS_CLASS;
+
+// Deadline of a job locked with deadline_ns 0, from the time it asked
+#define HRC_BUS_DRAIN_SLACK_US       10000
+#define HRC_BUS_CONFIG_SLACK_US      20000
+#define HRC_BUS_BACKGROUND_SLACK_US  200000
+
+typedef struct {
+	uint32_t jobs;
+	uint32_t contended;     // jobs that had to wait for another one
+	uint32_t late;          // jobs granted after their deadline
+	uint32_t max_wait_us;
+	uint64_t busy_ns;       // time the bus was held
+	uint64_t bytes;         // on the wire, address and register bytes included
+} HRC_BUS_CLASS_STATS;
+
+typedef struct {
+	uint64_t since_ns;      // CLOCK_MONOTONIC the bus was first used
+	HRC_BUS_CLASS_STATS cls[HRC_BUS_CLASSES];
+} HRC_BUS_STATS;
+
+typedef struct {
+	char name[32];
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// job holding the bus, depth 0 when free
+	pthread_t owner;
+	uint32_t depth;         // HRC_BusLock calls of the owner not yet unlocked
+	HRC_BUS_CLASS owner_class;
+	uint64_t start_ns;
+	uint32_t job_bytes;
+
+	uint32_t waiting;
+	uint32_t next_ticket;   // orders waiters with equal class and deadline
+	struct {
+		HRC_BUS_CLASS cls;
+		uint64_t deadline_ns;
+		uint32_t ticket;
+	} waiters[HRC_BUS_MAX_WAITERS];
+
+	HRC_BUS_STATS stats;
+} HRC_BUS;
+
+// The bus called name, created on first use; NULL when HRC_BUS_MAX are in use
+HRC_BUS *HRC_BusGet(const char *name);
+
+// Waits until the bus is granted to this job. Nested calls from the thread
+// holding the bus return at once and belong to the job already running.
+// deadline_ns - CLOCK_MONOTONIC the job is due, 0 for the slack of its class
+// A NULL bus is not shared, all calls return at once.
+void HRC_BusLock(HRC_BUS *bus, HRC_BUS_CLASS cls, uint64_t deadline_ns);
+// bytes - put on the wire since HRC_BusLock
+void HRC_BusUnlock(HRC_BUS *bus, uint32_t bytes);
+
+uint64_t HRC_BusNowNs(void);
+
+const char *HRC_BusClassName(HRC_BUS_CLASS cls);
+void HRC_BusGetStats(HRC_BUS *bus, HRC_BUS_STATS *stats);
+
+// Prints the utilization of every bus
+void HRC_BusDump(void);
+
+#endif
@@ -0,0 +1,139 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "HRC_clock.h"
+
+void HRC_ClockInit(HRC_CLOCK *clock, uint16_t rate) {
+	memset(clock, 0, sizeof(*clock));
+	clock->nominal_ns = 1000000000U / (rate ? rate : 1);
+	clock->period_q16 = (uint64_t) clock->nominal_ns << 16;
+	clock->window_ms = HRC_CLOCK_FIRST_WINDOW_MS;
+}
+
+void HRC_ClockRestart(HRC_CLOCK *clock) {
+	clock->locked = false;
+}
+
+void HRC_ClockSetRate(HRC_CLOCK *clock, uint16_t rate) {
+	// estimated over configured period in Q32, every rate comes from the one oscillator
+	uint64_t ratio = (clock->period_q16 << 16) / clock->nominal_ns;
+
+	clock->nominal_ns = 1000000000U / (rate ? rate : 1);
+	clock->period_q16 = (clock->nominal_ns * ratio) >> 16;
+	clock->locked = false;
+}
+
+// Closes the window once it spans window_ms, the samples placed in it give the
+// period; both ends are read times, so the error is about one period per window
+static void HRC_ClockMeasure(HRC_CLOCK *clock, uint64_t read_ns) {
+	uint64_t span = read_ns - clock->window_ns;
+	uint64_t nominal = (uint64_t) clock->nominal_ns << 16;
+	uint64_t tolerance = nominal * HRC_CLOCK_MAX_PPM / 1000000;
+	uint64_t measured;
+
+	if (span < clock->window_ms * 1000000ULL || clock->window_n == 0)
+		return;
+
+	measured = (span << 16) / clock->window_n;
+	if (measured + tolerance >= nominal && measured <= nominal + tolerance) {
+		// a longer window beats everything before it, full length ones are averaged
+		if (clock->measured && clock->window_ms == HRC_CLOCK_WINDOW_MS)
+			clock->period_q16 += ((int64_t) measured - (int64_t) clock->period_q16) / (1 << HRC_CLOCK_PERIOD_SHIFT);
+		else
+			clock->period_q16 = measured;
+		clock->measured = true;
+	}
+
+	if (clock->window_ms < HRC_CLOCK_WINDOW_MS)
+		clock->window_ms = clock->window_ms * 2 < HRC_CLOCK_WINDOW_MS ? clock->window_ms * 2 : HRC_CLOCK_WINDOW_MS;
+	clock->window_ns = read_ns;
+	clock->window_n = 0;
+}
+
+void HRC_ClockPlace(HRC_CLOCK *clock, uint32_t lost, uint8_t count, uint64_t read_ns, uint64_t *times) {
+	uint64_t newest_ns, floor_ns, acc;
+	uint16_t frac;
+	int ix;
+
+	if (count == 0)
+		return;
+
+	floor_ns = clock->last_ns;
+	if (!clock->locked) {
+		// nothing to go by yet but the bound
+		newest_ns = read_ns;
+		frac = 0;
+		clock->locked = true;
+		clock->slack_ns = UINT64_MAX;
+		clock->drains = 0;
+		clock->window_ns = read_ns;
+		clock->window_n = 0;
+	} else {
+		acc = clock->last_frac + (uint64_t) (lost + count) * clock->period_q16;
+		newest_ns = clock->last_ns + (acc >> 16);
+		frac = acc & 0xFFFF;
+
+		if (newest_ns > read_ns) {
+			// no sample is newer than the read that found it
+			newest_ns = read_ns;
+			frac = 0;
+			clock->slack_ns = 0;
+		} else if (read_ns - newest_ns < clock->slack_ns) {
+			clock->slack_ns = read_ns - newest_ns;
+		}
+
+		// the newest sample is taken before the read by a part of a period that
+		// varies from drain to drain, the smallest part is the closest bound
+		if (++clock->drains == HRC_CLOCK_ENVELOPE) {
+			newest_ns += clock->slack_ns;
+			clock->slack_ns = UINT64_MAX;
+			clock->drains = 0;
+		}
+
+		clock->window_n += lost + count;
+		HRC_ClockMeasure(clock, read_ns);
+	}
+
+	clock->last_ns = newest_ns;
+	clock->last_frac = frac;
+
+	// one period apart back from the newest, never before what was placed already
+	for (ix = 0; ix < count; ix++) {
+		times[ix] = newest_ns - (((uint64_t) (count - 1 - ix) * clock->period_q16) >> 16);
+		if (times[ix] <= floor_ns)
+			times[ix] = floor_ns + 1;
+		floor_ns = times[ix];
+	}
+}
+
+uint32_t HRC_ClockPeriodNs(const HRC_CLOCK *clock) {
+	return (clock->period_q16 + 0x8000) >> 16;
+}
+
+uint32_t HRC_ClockRateMilliHz(const HRC_CLOCK *clock) {
+	return (1000000000000ULL << 16) / clock->period_q16;
+}
+
+int32_t HRC_ClockDriftPpm(const HRC_CLOCK *clock) {
+	int64_t nominal = (int64_t) clock->nominal_ns << 16;
+
+	return (nominal - (int64_t) clock->period_q16) * 1000000 / (int64_t) clock->period_q16;
+}
@@ -0,0 +1,80 @@
+/*
+ ** Sample clock: per sample times from the drain times and the sensor's real rate
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_CLOCK__
+#define __HRC_CLOCK__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The sensor samples on its own oscillator, a few percent off the configured
+// rate. Samples are placed one estimated period apart. A drain bounds the
+// newest sample to at most the time the FIFO pointers were read; a timeline
+// past that bound is pulled back at once, one short of it is moved up by the
+// smallest slack of HRC_CLOCK_ENVELOPE drains. The period is measured against
+// CLOCK_MONOTONIC over windows that double from HRC_CLOCK_FIRST_WINDOW_MS to
+// HRC_CLOCK_WINDOW_MS, each good to about one period.
+
+#define HRC_CLOCK_FIRST_WINDOW_MS  1000
+#define HRC_CLOCK_WINDOW_MS        10000
+#define HRC_CLOCK_MAX_PPM          100000  // windows measuring further off the configured rate are discarded
+#define HRC_CLOCK_ENVELOPE         32      // drains whose smallest slack moves the timeline up
+#define HRC_CLOCK_PERIOD_SHIFT     2       // a window moves the period 1/4 of the way to its measurement
+
+typedef struct {
+	uint32_t nominal_ns;    // period of the configured rate
+	uint64_t period_q16;    // estimated period [ns Q16]
+	bool measured;          // period_q16 comes from at least one window
+	uint32_t window_ms;     // length of the next window
+
+	bool locked;            // last_ns places the samples to come
+	uint64_t last_ns;       // time of the newest sample placed
+	uint16_t last_frac;     // and its fraction of a ns [Q16]
+	uint64_t slack_ns;      // least read time past the newest sample of the drains since the last move
+	uint8_t drains;         // drains since the last move
+
+	uint64_t window_ns;     // read time the measurement window started at
+	uint32_t window_n;      // samples placed since
+} HRC_CLOCK;
+
+// rate - configured samples per second
+void HRC_ClockInit(HRC_CLOCK *clock, uint16_t rate);
+
+// Starts the timeline over at the next drain, keeping the period; for a FIFO
+// that was emptied or lost an unknown number of samples
+void HRC_ClockRestart(HRC_CLOCK *clock);
+// Moves to another configured rate; the measured drift carries over, the
+// timeline starts over at the next drain
+void HRC_ClockSetRate(HRC_CLOCK *clock, uint16_t rate);
+
+// Timestamps the count samples one drain found, after lost ones the FIFO dropped.
+// read_ns - CLOCK_MONOTONIC just after the FIFO pointers were read
+// times - receives count CLOCK_MONOTONIC times, oldest first
+void HRC_ClockPlace(HRC_CLOCK *clock, uint32_t lost, uint8_t count, uint64_t read_ns, uint64_t *times);
+
+// Estimated period, the configured one until a window was measured
+uint32_t HRC_ClockPeriodNs(const HRC_CLOCK *clock);
+// Estimated rate [mHz]
+uint32_t HRC_ClockRateMilliHz(const HRC_CLOCK *clock);
+// Estimated rate against the configured one [ppm]
+int32_t HRC_ClockDriftPpm(const HRC_CLOCK *clock);
+
+#endif
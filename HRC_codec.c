@@ -0,0 +1,270 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "HRC_codec.h"
+
+#define HRC_CODEC_MAX_K      15
+#define HRC_CODEC_MAX_ORDER  2
+
+typedef struct {
+	uint8_t *buf;
+	size_t size;
+	size_t pos;          // bytes completed
+	uint64_t acc;        // pending bits, right aligned
+	uint8_t bits;
+	int overflow;
+} HRC_BIT_WRITER;
+
+typedef struct {
+	const uint8_t *buf;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	uint8_t bits;
+} HRC_BIT_READER;
+
+static void HRC_BitPut(HRC_BIT_WRITER *w, uint32_t value, uint8_t bits) {
+	w->acc = (w->acc << bits) | (value & ((1ULL << bits) - 1));
+	w->bits += bits;
+	while (w->bits >= 8) {
+		w->bits -= 8;
+		if (w->pos < w->size)
+			w->buf[w->pos] = (uint8_t) (w->acc >> w->bits);
+		else
+			w->overflow = 1;
+		w->pos++;
+	}
+}
+
+static void HRC_BitFlush(HRC_BIT_WRITER *w) {
+	if (w->bits)
+		HRC_BitPut(w, 0, 8 - w->bits);
+}
+
+// -1 when the block ends first
+static int64_t HRC_BitGet(HRC_BIT_READER *r, uint8_t bits) {
+	while (r->bits < bits) {
+		if (r->pos >= r->size)
+			return -1;
+		r->acc = (r->acc << 8) | r->buf[r->pos++];
+		r->bits += 8;
+	}
+	r->bits -= bits;
+	return (r->acc >> r->bits) & ((1ULL << bits) - 1);
+}
+
+static uint32_t HRC_ZigZag(int32_t x) {
+	return ((uint32_t) x << 1) ^ (uint32_t) (x >> 31);
+}
+
+static int32_t HRC_UnZigZag(uint32_t u) {
+	return (int32_t) (u >> 1) ^ -(int32_t) (u & 1);
+}
+
+// Prediction of x[i] from the samples before it, i >= 1
+static int32_t HRC_Predict(const uint16_t *x, uint16_t i, uint8_t order) {
+	if (order == 2 && i >= 2)
+		return 2 * x[i - 1] - x[i - 2];
+	return x[i - 1];
+}
+
+// Picks predictor order and Rice parameter with the fewest bits for one channel
+static uint8_t HRC_CodecChoose(const uint16_t *x, uint16_t count) {
+	uint64_t cost[HRC_CODEC_MAX_ORDER][HRC_CODEC_MAX_K + 1];
+	uint64_t best = UINT64_MAX;
+	uint8_t order, k, param = 0x10;
+	uint32_t u;
+	uint16_t i;
+
+	memset(cost, 0, sizeof(cost));
+	for (i = 1; i < count; i++) {
+		for (order = 1; order <= HRC_CODEC_MAX_ORDER; order++) {
+			u = HRC_ZigZag(x[i] - HRC_Predict(x, i, order));
+			for (k = 0; k <= HRC_CODEC_MAX_K; k++)
+				cost[order - 1][k] += (u >> k) < HRC_CODEC_ESCAPE ?
+						(u >> k) + 1 + k : HRC_CODEC_ESCAPE + HRC_CODEC_ESCAPE_BITS;
+		}
+	}
+
+	for (order = 1; order <= HRC_CODEC_MAX_ORDER; order++) {
+		for (k = 0; k <= HRC_CODEC_MAX_K; k++) {
+			if (cost[order - 1][k] < best) {
+				best = cost[order - 1][k];
+				param = (order << 4) | k;
+			}
+		}
+	}
+
+	return param;
+}
+
+static void HRC_CodecPutChannel(HRC_BIT_WRITER *w, const uint16_t *x, uint16_t count, uint8_t param) {
+	uint8_t order = param >> 4, k = param & 0x0F;
+	uint32_t u, q;
+	uint16_t i;
+
+	for (i = 1; i < count; i++) {
+		u = HRC_ZigZag(x[i] - HRC_Predict(x, i, order));
+		q = u >> k;
+		if (q < HRC_CODEC_ESCAPE) {
+			// q ones and a terminating zero
+			HRC_BitPut(w, (1U << (q + 1)) - 2, q + 1);
+			if (k)
+				HRC_BitPut(w, u, k);
+		} else {
+			HRC_BitPut(w, (1U << HRC_CODEC_ESCAPE) - 1, HRC_CODEC_ESCAPE);
+			HRC_BitPut(w, u, HRC_CODEC_ESCAPE_BITS);
+		}
+	}
+}
+
+static int HRC_CodecGetChannel(HRC_BIT_READER *r, uint16_t *x, uint16_t count, uint8_t param) {
+	uint8_t order = param >> 4, k = param & 0x0F;
+	int64_t bit, low;
+	uint32_t u, q;
+	int32_t value;
+	uint16_t i;
+
+	if (order < 1 || order > HRC_CODEC_MAX_ORDER)
+		return -1;
+
+	for (i = 1; i < count; i++) {
+		for (q = 0; q < HRC_CODEC_ESCAPE; q++) {
+			if ((bit = HRC_BitGet(r, 1)) < 0)
+				return -1;
+			if (bit == 0)
+				break;
+		}
+
+		if (q == HRC_CODEC_ESCAPE) {
+			if ((low = HRC_BitGet(r, HRC_CODEC_ESCAPE_BITS)) < 0)
+				return -1;
+			u = (uint32_t) low;
+		} else {
+			if ((low = k ? HRC_BitGet(r, k) : 0) < 0)
+				return -1;
+			u = (q << k) | (uint32_t) low;
+		}
+
+		value = HRC_Predict(x, i, order) + HRC_UnZigZag(u);
+		if (value < 0 || value > UINT16_MAX)
+			return -1;
+		x[i] = (uint16_t) value;
+	}
+
+	return 0;
+}
+
+int HRC_CodecEncodeBlock(uint32_t seq, const uint16_t *ir, const uint16_t *red, uint16_t count,
+		uint8_t *out, size_t size) {
+	HRC_BIT_WRITER w;
+	uint8_t ir_param, red_param;
+
+	if (count == 0 || count > HRC_CODEC_BLOCK || size < HRC_CODEC_HEADER_SIZE)
+		return -1;
+
+	ir_param = HRC_CodecChoose(ir, count);
+	red_param = HRC_CodecChoose(red, count);
+
+	memset(&w, 0, sizeof(w));
+	w.buf = out;
+	w.size = size;
+
+	HRC_BitPut(&w, HRC_CODEC_VERSION, 8);
+	HRC_BitPut(&w, 0, 16);                  // length, filled in below
+	HRC_BitPut(&w, seq >> 16, 16);
+	HRC_BitPut(&w, seq, 16);
+	HRC_BitPut(&w, count, 16);
+	HRC_BitPut(&w, ir[0], 16);
+	HRC_BitPut(&w, red[0], 16);
+	HRC_BitPut(&w, ir_param, 8);
+	HRC_BitPut(&w, red_param, 8);
+
+	HRC_CodecPutChannel(&w, ir, count, ir_param);
+	HRC_CodecPutChannel(&w, red, count, red_param);
+	HRC_BitFlush(&w);
+
+	if (w.overflow || w.pos > UINT16_MAX)
+		return -1;
+
+	out[1] = (uint8_t) (w.pos >> 8);
+	out[2] = (uint8_t) w.pos;
+
+	return (int) w.pos;
+}
+
+int HRC_CodecDecodeBlock(const uint8_t *in, size_t size, uint32_t *seq, uint16_t *ir, uint16_t *red,
+		uint16_t *count) {
+	HRC_BIT_READER r;
+	size_t length;
+	uint16_t n;
+
+	if (size < HRC_CODEC_HEADER_SIZE || in[0] != HRC_CODEC_VERSION)
+		return -1;
+
+	length = (in[1] << 8) | in[2];
+	n = (in[7] << 8) | in[8];
+	if (length < HRC_CODEC_HEADER_SIZE || length > size || n == 0 || n > HRC_CODEC_BLOCK)
+		return -1;
+
+	*seq = ((uint32_t) in[3] << 24) | (in[4] << 16) | (in[5] << 8) | in[6];
+	*count = n;
+	ir[0] = (in[9] << 8) | in[10];
+	red[0] = (in[11] << 8) | in[12];
+
+	memset(&r, 0, sizeof(r));
+	r.buf = in + HRC_CODEC_HEADER_SIZE;
+	r.size = length - HRC_CODEC_HEADER_SIZE;
+
+	if (HRC_CodecGetChannel(&r, ir, n, in[13]) < 0 || HRC_CodecGetChannel(&r, red, n, in[14]) < 0)
+		return -1;
+
+	return (int) length;
+}
+
+void HRC_CodecInit(HRC_CODEC *codec, uint32_t seq) {
+	codec->seq = seq;
+	codec->count = 0;
+}
+
+int HRC_CodecFlush(HRC_CODEC *codec, uint8_t *out, size_t size) {
+	int length;
+
+	if (codec->count == 0)
+		return 0;
+
+	length = HRC_CodecEncodeBlock(codec->seq, codec->ir, codec->red, codec->count, out, size);
+	// the sequence number advances either way, a gap marks the lost block
+	codec->seq++;
+	codec->count = 0;
+
+	return length;
+}
+
+int HRC_CodecPush(HRC_CODEC *codec, uint16_t ir, uint16_t red, uint8_t *out, size_t size) {
+	codec->ir[codec->count] = ir;
+	codec->red[codec->count] = red;
+
+	if (++codec->count < HRC_CODEC_BLOCK)
+		return 0;
+
+	return HRC_CodecFlush(codec, out, size);
+}
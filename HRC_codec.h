@@ -0,0 +1,76 @@
+/* 
+ ** Lossless PPG waveform codec
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_CODEC__
+#define __HRC_CODEC__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Block layout, multi-byte fields big-endian:
+//   0     version (HRC_CODEC_VERSION)
+//   1-2   block length in bytes, header included
+//   3-6   sequence number
+//   7-8   samples in the block, 1..HRC_CODEC_BLOCK
+//   9-10  first IR sample, 11-12 first RED sample
+//   13    IR predictor order << 4 | Rice parameter, 14 the same for RED
+//   15-   IR residuals, then RED residuals, MSB first, zero padded to a byte
+// Residuals are zig-zag mapped and Rice coded; a quotient of HRC_CODEC_ESCAPE
+// is followed by the raw value in HRC_CODEC_ESCAPE_BITS instead.
+// Each block decodes on its own.
+
+#define HRC_CODEC_VERSION      1
+#define HRC_CODEC_BLOCK        512   // samples per block
+#define HRC_CODEC_HEADER_SIZE  15
+#define HRC_CODEC_ESCAPE       24
+#define HRC_CODEC_ESCAPE_BITS  20    // an order 2 residual of 16 bit samples fits in 19
+
+// Largest block for count samples
+#define HRC_CODEC_MAX_BLOCK_SIZE(count) \
+	(HRC_CODEC_HEADER_SIZE + (2 * ((count) - 1) * (HRC_CODEC_ESCAPE + HRC_CODEC_ESCAPE_BITS) + 7) / 8)
+
+// Streaming encoder, collects samples until a block is full
+typedef struct {
+	uint32_t seq;            // sequence number of the next block
+	uint16_t count;
+	uint16_t ir[HRC_CODEC_BLOCK];
+	uint16_t red[HRC_CODEC_BLOCK];
+} HRC_CODEC;
+
+void HRC_CodecInit(HRC_CODEC *codec, uint32_t seq);
+
+// Adds one sample. When that completes a block it is encoded to out and its
+// length returned, otherwise 0; -1 when out is too small (the block is lost).
+int HRC_CodecPush(HRC_CODEC *codec, uint16_t ir, uint16_t red, uint8_t *out, size_t size);
+
+// Encodes the samples collected so far as a short block, 0 when there are none
+int HRC_CodecFlush(HRC_CODEC *codec, uint8_t *out, size_t size);
+
+// Returns the block length, or -1 when it does not fit in size
+int HRC_CodecEncodeBlock(uint32_t seq, const uint16_t *ir, const uint16_t *red, uint16_t count,
+		uint8_t *out, size_t size);
+
+// Reference decoder. ir and red hold HRC_CODEC_BLOCK samples.
+// Returns the bytes consumed, or -1 for a truncated or malformed block.
+int HRC_CodecDecodeBlock(const uint8_t *in, size_t size, uint32_t *seq, uint16_t *ir, uint16_t *red,
+		uint16_t *count);
+
+#endif
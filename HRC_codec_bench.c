@@ -0,0 +1,265 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compression ratio and throughput of the waveform codec, with every block
+// checked against the reference decoder. Built with "make codec-bench":
+//   HRC_codec_bench [recording]...
+// Codes one minute of simulated waveform per sample format and noise level,
+// then each recording: raw FIFO bytes, IR and RED big-endian per sample.
+// Ratios are against raw 16 bit samples. Exits with 1 on the first block
+// that does not decode to its input.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "HRC_defines.h"
+#include "HRC_sim.h"
+#include "HRC_codec.h"
+
+#define HRC_CODEC_BENCH_SECONDS   60
+#define HRC_CODEC_BENCH_MIN_NS    200000000ULL  // each throughput run is repeated for at least this long
+#define HRC_CODEC_BENCH_WORST     2000          // random blocks of the worst case check
+
+static uint8_t hrc_bench_block[HRC_CODEC_MAX_BLOCK_SIZE(HRC_CODEC_BLOCK)];
+
+static uint64_t HRC_CodecBenchNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Encodes and decodes one block, returns its length or -1 when the round trip is not exact
+static int HRC_CodecBenchRoundTrip(uint32_t seq, const uint16_t *ir, const uint16_t *red, uint16_t count) {
+	uint16_t ir_out[HRC_CODEC_BLOCK], red_out[HRC_CODEC_BLOCK];
+	uint16_t count_out;
+	uint32_t seq_out;
+	int length;
+
+	length = HRC_CodecEncodeBlock(seq, ir, red, count, hrc_bench_block, sizeof(hrc_bench_block));
+	if (length < 0 || length > HRC_CODEC_MAX_BLOCK_SIZE(count)) {
+		printf("block %u: %d bytes for %u samples\n", seq, length, count);
+		return -1;
+	}
+
+	if (HRC_CodecDecodeBlock(hrc_bench_block, length, &seq_out, ir_out, red_out, &count_out) != length ||
+			seq_out != seq || count_out != count ||
+			memcmp(ir, ir_out, count * sizeof(ir[0])) != 0 || memcmp(red, red_out, count * sizeof(red[0])) != 0) {
+		printf("block %u: does not decode to its %u samples\n", seq, count);
+		return -1;
+	}
+
+	// one byte short must be refused, not read past
+	if (HRC_CodecDecodeBlock(hrc_bench_block, length - 1, &seq_out, ir_out, red_out, &count_out) >= 0) {
+		printf("block %u: decoded with its last byte missing\n", seq);
+		return -1;
+	}
+
+	return length;
+}
+
+// Samples per second of encoding all of ir/red in blocks
+static double HRC_CodecBenchEncode(const uint16_t *ir, const uint16_t *red, uint32_t count) {
+	uint64_t start = HRC_CodecBenchNowNs(), elapsed, samples = 0;
+	uint32_t ix;
+	uint16_t n;
+
+	do {
+		for (ix = 0; ix < count; ix += n) {
+			n = count - ix < HRC_CODEC_BLOCK ? count - ix : HRC_CODEC_BLOCK;
+			HRC_CodecEncodeBlock(ix, ir + ix, red + ix, n, hrc_bench_block, sizeof(hrc_bench_block));
+		}
+		samples += count;
+		elapsed = HRC_CodecBenchNowNs() - start;
+	} while (elapsed < HRC_CODEC_BENCH_MIN_NS);
+
+	return samples * 1e9 / elapsed;
+}
+
+// Samples per second of decoding the blocks in stream, count samples in all
+static double HRC_CodecBenchDecode(const uint8_t *stream, size_t size, uint32_t count) {
+	uint16_t ir[HRC_CODEC_BLOCK], red[HRC_CODEC_BLOCK];
+	uint64_t start = HRC_CodecBenchNowNs(), elapsed, samples = 0;
+	uint32_t seq;
+	uint16_t n;
+	size_t at;
+
+	do {
+		for (at = 0; at < size; )
+			at += HRC_CodecDecodeBlock(stream + at, size - at, &seq, ir, red, &n);
+		samples += count;
+		elapsed = HRC_CodecBenchNowNs() - start;
+	} while (elapsed < HRC_CODEC_BENCH_MIN_NS);
+
+	return samples * 1e9 / elapsed;
+}
+
+static bool HRC_CodecBenchRun(const char *name, const uint16_t *ir, const uint16_t *red, uint32_t count) {
+	size_t bytes = 0;
+	uint8_t *stream;
+	uint32_t ix;
+	uint16_t n;
+	int length;
+
+	stream = malloc((count / HRC_CODEC_BLOCK + 1) * sizeof(hrc_bench_block));
+	if (stream == NULL) {
+		printf("%s: out of memory\n", name);
+		return false;
+	}
+
+	for (ix = 0; ix < count; ix += n) {
+		n = count - ix < HRC_CODEC_BLOCK ? count - ix : HRC_CODEC_BLOCK;
+		if ((length = HRC_CodecBenchRoundTrip(ix / HRC_CODEC_BLOCK, ir + ix, red + ix, n)) < 0) {
+			free(stream);
+			return false;
+		}
+		memcpy(stream + bytes, hrc_bench_block, length);
+		bytes += length;
+	}
+
+	printf("%-30s %8u %9zu %6.2f %8.2f %8.2f\n", name, count, bytes, count * 4.0 / bytes,
+			HRC_CodecBenchEncode(ir, red, count) / 1e6, HRC_CodecBenchDecode(stream, bytes, count) / 1e6);
+
+	free(stream);
+	return true;
+}
+
+// Blocks of random full scale samples, of jumps between the extremes, and of
+// a flat line with full scale spikes now and then: the Rice parameter stays
+// small and the spikes take the escape path
+static bool HRC_CodecBenchWorst(void) {
+	uint16_t ir[HRC_CODEC_BLOCK], red[HRC_CODEC_BLOCK];
+	uint32_t rng = 1, round, ix;
+	uint16_t count;
+
+	for (round = 0; round < HRC_CODEC_BENCH_WORST; round++) {
+		count = round < HRC_CODEC_BLOCK ? round + 1 : HRC_CODEC_BLOCK;
+		for (ix = 0; ix < count; ix++) {
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			switch (round % 3) {
+			case 0:
+				ir[ix] = (uint16_t) rng;
+				red[ix] = (uint16_t) (rng >> 16);
+				break;
+			case 1:
+				ir[ix] = (rng & 1) ? UINT16_MAX : 0;
+				red[ix] = (rng & 2) ? UINT16_MAX : 0;
+				break;
+			default:
+				ir[ix] = (rng % 16 == 0) ? UINT16_MAX : 0;
+				red[ix] = (rng % 16 == 1) ? UINT16_MAX : 0;
+				break;
+			}
+		}
+		if (HRC_CodecBenchRoundTrip(round, ir, red, count) < 0)
+			return false;
+	}
+
+	printf("%u worst case blocks of 1..%u samples: exact, within HRC_CODEC_MAX_BLOCK_SIZE\n",
+			HRC_CODEC_BENCH_WORST, HRC_CODEC_BLOCK);
+	return true;
+}
+
+static bool HRC_CodecBenchRecording(const char *path) {
+	uint8_t raw[4];
+	uint16_t *ir = NULL, *red = NULL;
+	uint32_t count = 0, room = 0;
+	bool result;
+	FILE *file;
+
+	if ((file = fopen(path, "rb")) == NULL) {
+		printf("%s: cannot open\n", path);
+		return false;
+	}
+
+	while (fread(raw, sizeof(raw), 1, file) == 1) {
+		if (count == room) {
+			room = room ? room * 2 : 65536;
+			ir = realloc(ir, room * sizeof(ir[0]));
+			red = realloc(red, room * sizeof(red[0]));
+			if (ir == NULL || red == NULL) {
+				printf("%s: out of memory\n", path);
+				fclose(file);
+				return false;
+			}
+		}
+		ir[count] = (raw[0] << 8) | raw[1];
+		red[count] = (raw[2] << 8) | raw[3];
+		count++;
+	}
+	fclose(file);
+
+	result = count == 0 || HRC_CodecBenchRun(path, ir, red, count);
+	free(ir);
+	free(red);
+	return result;
+}
+
+int main(int argc, char **argv) {
+	static const struct {
+		uint8_t spo2;
+		const char *name;
+	} formats[] = {
+		{ HRC_SAMPLES_50 | HRC_PULSE_WIDTH_1600, "50 sps 16 bit" },
+		{ HRC_SAMPLES_100 | HRC_PULSE_WIDTH_1600, "100 sps 16 bit" },
+		{ HRC_SAMPLES_200 | HRC_PULSE_WIDTH_800, "200 sps 15 bit" },
+		{ HRC_SAMPLES_400 | HRC_PULSE_WIDTH_400, "400 sps 14 bit" },
+		{ HRC_DEFAULT_SPO2, "400 sps 15 bit" },
+	};
+	static const double noise[] = { 0.0, 0.02, 0.1 };
+	static uint16_t ir[1000 * HRC_CODEC_BENCH_SECONDS], red[1000 * HRC_CODEC_BENCH_SECONDS];
+	HRC_SIM_CONFIG cfg = HRC_SIM_CONFIG_DEFAULT;
+	uint16_t rates[8] = { 50, 100, 167, 200, 400, 600, 800, 1000 };
+	char name[48];
+	uint32_t f, k, count;
+	int file, arg;
+
+	printf("%-30s %8s %9s %6s %8s %8s\n", "waveform", "samples", "bytes", "ratio", "enc Ms/s", "dec Ms/s");
+
+	for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (k = 0; k < sizeof(noise) / sizeof(noise[0]); k++) {
+			cfg.noise = noise[k];
+			if ((file = HRC_SimOpen(&cfg)) < 0)
+				return 1;
+
+			// configured as HRC_Initialize does
+			HRC_TransportSim.write_byte(file, HRC_MODE_CONFIG, HRC_SPO2_EN);
+			HRC_TransportSim.write_byte(file, HRC_SPO2_CONFIG, HRC_SPO2_HI_RES_EN | formats[f].spo2);
+			HRC_TransportSim.write_byte(file, HRC_LED_CONFIG, HRC_IR_CURRENT_110 | HRC_RED_CURRENT_110);
+
+			count = rates[(formats[f].spo2 & HRC_SAMPLES_MASK) >> 2] * HRC_CODEC_BENCH_SECONDS;
+			HRC_SimWaveform(file, ir, red, count);
+			HRC_SimClose(file);
+
+			snprintf(name, sizeof(name), "sim %s, noise %.2f", formats[f].name, noise[k]);
+			if (!HRC_CodecBenchRun(name, ir, red, count))
+				return 1;
+		}
+	}
+
+	for (arg = 1; arg < argc; arg++)
+		if (!HRC_CodecBenchRecording(argv[arg]))
+			return 1;
+
+	return HRC_CodecBenchWorst() ? 0 : 1;
+}
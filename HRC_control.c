@@ -36,196 +36,377 @@
 
 
 #include "HRC_driver.h" 
+#include "HRC_fixed.h"
+#include "HRC_text.h"
+#include "HRC_irq.h"
+#include "HRC_ring.h"
+#include "HRC_hr.h"
+#include "HRC_spo2.h"
+#include "HRC_codec.h"
+#include "HRC_stats.h"
 //#include "websocket_protocol.h"
 
-HRC_DATA my_data;
-uint32_t counter = 0;
-extern volatile uint8_t data_ready;
+static uint64_t HRC_DrainNowNs(void) {
+	struct timespec now;
 
-uint8_t RevId = 0;
-uint8_t PartId = 0;
-uint16_t tempValue = 0;
-uint16_t irBuff[16] = {0};
-uint16_t redBuff[16] = {0};
-uint8_t register_dump[20];
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
 
-int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y);
+void HRC_Register_Dump(HRC_DEVICE *dev) {
+	// adjacent registers in one transaction each, skipping FIFO_DATA, which
+	// pops a sample, and the pointers; a drain may only wait for one block
+	static const struct {
+		uint8_t first;
+		uint8_t count;
+		const char *names[4];
+	} blocks[] = {
+		{ HRC_INT_STATUS, 2, { "HRC_INT_STATUS", "HRC_INT_ENABLE" } },
+		{ HRC_MODE_CONFIG, 4, { "HRC_MODE_CONFIG", "HRC_SPO2_CONFIG", NULL, "HRC_LED_CONFIG" } },
+		{ HRC_TEMP_INTEGER, 2, { "HRC_TEMP_INTEGER", "HRC_TEMP_FRACTIO" } },
+		{ HRC_REVISION_ID, 2, { "HRC_REVISION_ID", "HRC_PART_ID" } },
+	};
+	uint8_t data[4];
+	uint32_t ix, reg;
 
-void HRC_Register_Dump(int file) {
-	uint8_t data;
+	printf("======== Register Dump: ======== \n");
 
-#define WAIT_US  500
+	for (ix = 0; ix < sizeof(blocks) / sizeof(blocks[0]); ix++) {
+		HRC_BusLock(dev->bus, HRC_BUS_BACKGROUND, 0);
+		if (HRC_ReadBlockFromSensor(dev, blocks[ix].first, data, blocks[ix].count) != 0)
+			memset(data, 0xFF, sizeof(data));
+		HRC_BusUnlock(dev->bus, 0);
 
-	printf("======== Register Dump: ======== \n");
+		for (reg = 0; reg < blocks[ix].count; reg++)
+			if (blocks[ix].names[reg])
+				printf("%s: \t%02x\n", blocks[ix].names[reg], data[reg]);
+	}
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_INT_STATUS);
-	printf("HRC_INT_STATUS: \t%02x\n", data);
+	printf("================================ \n");
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_INT_ENABLE);
-	printf("HRC_INT_ENABLE: \t%02x\n", data);
+}
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
-	printf("HRC_MODE_CONFIG: \t%02x\n", data);
+int HRC_Startup(HRC_DEVICE *dev) {
+	HRC_Q16 temperature;
+	HRC_CONFIG config;
+	HRC_TEXT text;
+	char buf[16];
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_SPO2_CONFIG);
-	printf("HRC_SPO2_CONFIG: \t%02x\n", data);
+	HRC_RingInit(&dev->ring);
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_INT_ENABLE);
-	printf("HRC_INT_ENABLE: \t%02x\n", data);
+	dev->revision_id = HRC_GetRevisionID(dev);
+	dev->part_id = HRC_GetPartID(dev);
+	printf("%s: HRC Part ID = %02x Revision ID = %02x\n\r", dev->name, dev->part_id, dev->revision_id);
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_LED_CONFIG);
-	printf("HRC_LED_CONFIG: \t%02x\n", data);
+	printf("Reset...\n");
+	HRC_Reset(dev);
+	printf("Initialize...\n");
+	if (HRC_Initialize(dev) == 0 || HRC_GetShadowConfig(dev, &config) < 0)
+		return -1;
+	//HRC_Register_Dump(dev);
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_TEMP_INTEGER);
-	printf("HRC_TEMP_INTEGER: \t%02x\n", data);
+	HRC_DrainInit(dev, config.spo2);
+	HRC_SampleFormat(config.spo2, &dev->format);
+	HRC_HrInit(&dev->hr, dev->format.rate);
+	HRC_Spo2Init(&dev->spo2, dev->format.rate);
+	HRC_CodecInit(&dev->codec, 0);
+	dev->held.valid = false;
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_TEMP_FRACTION);
-	printf("HRC_TEMP_FRACTIO: \t%02x\n", data);
+	while (HRC_IrqWait(&dev->irq, dev, HRC_IRQ_TIMEOUT_MS) == 0);
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_REVISION_ID);
-	printf("HRC_REVISION_ID: \t%02x\n", data);
+	// the conversion is long done when the sensor has settled
+	HRC_StartTemperature(dev);
+	sleep(3);
+	if (HRC_PollTemperature(dev) > 0) {
+		temperature = HRC_TemperatureQ16(dev->temp.value);
+		HRC_TextInit(&text, buf, sizeof(buf));
+		HRC_TextPutQ16(&text, temperature, 2);
+		printf("%s: Temperature: %s\n\r", dev->name, buf);
+	}
+	HRC_ResetFifo(dev);
 
-	usleep(WAIT_US);
-	data = HRC_ReadFromSensor(file, HRC_PART_ID);
-	printf("HRC_PART_ID: \t%02x\n", data);
+	return 0;
+}
 
-	printf("================================ \n");
+void HRC_ResetFifo(HRC_DEVICE *dev) {
+	HRC_SendToSensor(dev, HRC_FIFO_WRITE_PTR, 0);
+	HRC_SendToSensor(dev, HRC_OVER_FLOW_CNT, 0);
+	HRC_SendToSensor(dev, HRC_FIFO_READ_PTR, 0);
+	dev->drain.last_ns = HRC_DrainNowNs();
+	HRC_ClockRestart(&dev->drain.clock);
+	// edges queued meanwhile refer to the FIFO contents just discarded
+	HRC_IrqAck(&dev->irq);
+}
 
+HRC_Q16 CollectTempData(HRC_DEVICE *dev)
+{
+	HRC_Q16 temperature;
+	HRC_TEXT text;
+	char buf[16];
+
+	// fetch the conversion started on the previous tick, which a drain has
+	// normally seen finish meanwhile, and start the next one; nothing waits
+	HRC_PollTemperature(dev);
+	HRC_StartTemperature(dev);
+	temperature = HRC_TemperatureQ16(dev->temp.value);
+	HRC_TextInit(&text, buf, sizeof(buf));
+	HRC_TextPutQ16(&text, temperature, 2);
+	printf("%s: Temperature: %s\n\r", dev->name, buf);
+	return temperature;
 }
 
-void HRC_Startup(int file) {
-	TEMPERATURE_VALUE temperature;
-	MODE_CONFIG_BITS configuration;
+void HRC_DrainInit(HRC_DEVICE *dev, uint8_t spo2_config) {
+	atomic_store(&dev->format_request, 0);
+	dev->drain.spo2 = spo2_config & (HRC_SAMPLES_MASK | HRC_PULSE_WIDTH_MASK);
+	dev->drain.rate = HRC_SampleRate(spo2_config);
+	dev->drain.sample_ns = 1000000000U / dev->drain.rate;
+	dev->drain.last_ns = HRC_DrainNowNs();
+	HRC_ClockInit(&dev->drain.clock, dev->drain.rate);
+	dev->drain.stats.interval_us = HRC_DRAIN_TARGET * (dev->drain.sample_ns / 1000);
+}
 
-	RevId = HRC_GetRevisionID(file);
-	PartId = HRC_GetPartID(file);
-	printf("HRC Part ID = %02x Revision ID = %02x\n\r", PartId, RevId);
+uint32_t HRC_DrainInterval(const HRC_DEVICE *dev) {
+	return dev->drain.stats.interval_us;
+}
 
-	printf("Reset...\n");
-	HRC_Reset(file);
-	printf("Initialize...\n");
-	HRC_Initialize(file);
-	//HRC_Register_Dump(file);
+void HRC_GetDrainStats(const HRC_DEVICE *dev, HRC_DRAIN_STATS *stats) {
+	*stats = dev->drain.stats;
+}
 
-	while (HRC_GetStatus(file).A_FULL == 0);
+// Switches to the format asked for with HRC_RequestFormat. The FIFO is emptied
+// with the switch, so the drain picks up as after HRC_ResetFifo, at the new rate.
+static void HRC_DrainSwitch(HRC_DEVICE *dev) {
+	unsigned int request = atomic_load(&dev->format_request);
+	uint16_t old_rate = dev->drain.rate;
+	int spo2;
+
+	if ((request & HRC_FORMAT_REQUEST) == 0)
+		return;
+
+	// taken only now that drain.spo2 is current: a request merged in meanwhile
+	// (HRC_SetSamples) stays for the next drain
+	if ((request & 0xFF) == dev->drain.spo2) {
+		atomic_compare_exchange_strong(&dev->format_request, &request, 0);
+		return;
+	}
 
-	configuration.byte = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
-	configuration.TEMP_EN = 1;
-	HRC_SendToSensor(file, HRC_MODE_CONFIG, configuration.byte);
-	while (HRC_GetStatus(file).TEMP_RDY == 0);
-	temperature.value = HRC_ReadTemperature(file);
-	printf("Temperature: %d.%d\n\r", temperature.byte[0], (int) ((0.0625 * (float) temperature.byte[1])*100.0));
-	sleep(3);
-	HRC_SendToSensor(file, HRC_FIFO_WRITE_PTR, 0);
-	HRC_SendToSensor(file, HRC_OVER_FLOW_CNT, 0);
-	HRC_SendToSensor(file, HRC_FIFO_READ_PTR, 0);
+	if ((spo2 = HRC_SwitchFormat(dev, request & 0xFF)) < 0) {
+		printf("%s: cannot switch the sample format\n", dev->name);
+		atomic_compare_exchange_strong(&dev->format_request, &request, 0);
+		return;
+	}
+
+	dev->drain.spo2 = spo2 & (HRC_SAMPLES_MASK | HRC_PULSE_WIDTH_MASK);
+	dev->drain.rate = HRC_SampleRate(spo2);
+	dev->drain.sample_ns = 1000000000U / dev->drain.rate;
+	dev->drain.last_ns = HRC_DrainNowNs();
+	dev->drain.stats.interval_us = HRC_DRAIN_TARGET * (dev->drain.sample_ns / 1000);
+	HRC_ClockSetRate(&dev->drain.clock, dev->drain.rate);
+	atomic_compare_exchange_strong(&dev->format_request, &request, 0);
+
+	// a simulated A_FULL keeps its time scale
+	HRC_IrqSetPeriod(&dev->irq, (uint64_t) dev->irq.poll_us * old_rate / dev->drain.rate);
+	// edges queued meanwhile refer to the FIFO contents just discarded
+	HRC_IrqAck(&dev->irq);
 }
 
-double CollectTempData(int file)
-{
-	//HRC_Initialize(file);
-	uint8_t configuration = 0;
-	double ret;
-	configuration = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
-	configuration = (configuration & ~0x07) | HRC_HR_ONLY;
-	configuration = (configuration & ~0x07) | HRC_TEMP_EN;
-	configuration = (configuration & ~0x07) | HRC_SPO2_EN;
-	//printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_MODE_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_MODE_CONFIG, configuration);
-
-	configuration = HRC_ReadFromSensor(file, HRC_SPO2_CONFIG);
-	configuration |= HRC_SPO2_HI_RES_EN;
-	configuration |= HRC_SAMPLES_400;
-	configuration |= HRC_PULSE_WIDTH_800;
-	//printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_SPO2_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_SPO2_CONFIG, configuration);
-
-	configuration = HRC_ReadFromSensor(file, HRC_LED_CONFIG);
-	configuration |= HRC_IR_CURRENT_110;
-	configuration |= HRC_RED_CURRENT_110;
-	//  printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_LED_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_LED_CONFIG, configuration);
-
-	configuration = HRC_ReadFromSensor(file, HRC_INT_ENABLE);
-	configuration |= HRC_ENA_A_FULL;
-	configuration |= HRC_ENA_HR_RDY;
-	configuration |= HRC_ENA_SO2_RDY;
-	configuration |= HRC_ENA_TEP_RDY;
-	//    printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_INT_ENABLE, configuration);
-	HRC_SendToSensor(file, HRC_INT_ENABLE, configuration);
-
-	//i2c_file = file;	
-	TEMPERATURE_VALUE temperature;
-	temperature.value = HRC_ReadTemperature(file);
-	printf("Temperature: %d.%d\n\r", temperature.byte[0], (int) ((0.0625 * (float) temperature.byte[1])*100.0));
-	//ret = temperature.byte[0] + ((int) ((0.0625 * (float) temperature.byte[1])*100.0));
-	return ret;
-}
-
-void HRC_Run(int file) {
+// Accounts one drain that found count samples and the overflow counter at
+// overflow, and moves the drain interval towards HRC_DRAIN_TARGET samples.
+// Returns the samples lost before the ones found.
+static uint32_t HRC_DrainUpdate(HRC_DEVICE *dev, uint8_t count, uint8_t overflow, uint64_t now_ns) {
+	HRC_DRAIN_STATS *stats = &dev->drain.stats;
+	uint32_t interval = stats->interval_us;
+	uint32_t max_us = HRC_FIFO_DEPTH * (dev->drain.sample_ns / 1000);
+	uint64_t produced;
+	uint32_t lost = overflow;
+
+	if (overflow) {
+		// the counter stops at 15, past that the time since the last drain tells
+		if (overflow == 0x0F && dev->drain.last_ns) {
+			produced = (now_ns - dev->drain.last_ns) / HRC_ClockPeriodNs(&dev->drain.clock);
+			if (produced > HRC_FIFO_DEPTH + lost)
+				lost = produced - HRC_FIFO_DEPTH;
+			stats->saturated++;
+		}
+		stats->overflows++;
+		stats->lost += lost;
+		interval /= 2;
+	} else if (count) {
+		// half way to the interval that would have found the target, i.e.
+		// scaled by the real rate of the sensor clock and the wakeup latency
+		interval = (interval + (uint64_t) interval * HRC_DRAIN_TARGET / count) / 2;
+	} else {
+		interval *= 2;
+	}
+
+	if (interval < HRC_DRAIN_MIN_US)
+		interval = HRC_DRAIN_MIN_US;
+	if (interval > max_us)
+		interval = max_us;
+	stats->interval_us = interval;
+
+	if (count) {
+		stats->drains++;
+		stats->samples += count;
+		if (count > stats->max_fill)
+			stats->max_fill = count;
+	}
+	dev->drain.last_ns = now_ns;
+
+	return lost;
+}
+
+int HRC_Drain(HRC_DEVICE *dev) {
 	int8_t ix;
-	struct timeval starttime, endtime, timediff;
-	char string[256];
-	char sub_string[100];
-	uint8_t string_length;
-
-	gettimeofday(&starttime, 0x0);
-	while (HRC_GetStatus(file).A_FULL == 0) {
-		usleep(1000);
+	HRC_RING_SAMPLE batch[HRC_FIFO_DEPTH];
+	uint64_t times[HRC_FIFO_DEPTH];
+	HRC_CLOCK *clock = &dev->drain.clock;
+	uint32_t lost;
+	int count;
+
+	HRC_STATS_START(start);
+	count = HRC_DrainFifo(dev, dev->data.sample, &dev->fifo);
+	if (count < 0)
+		return count;
+
+	lost = HRC_DrainUpdate(dev, count, dev->fifo.overflow, dev->fifo.read_ns);
+	if (count == 0) {
+		HRC_DrainSwitch(dev);
+		return 0;
+	}
+
+	// past a saturated overflow counter the samples lost are a guess
+	if (dev->fifo.overflow == 0x0F)
+		HRC_ClockRestart(clock);
+	HRC_ClockPlace(clock, lost, count, dev->fifo.read_ns, times);
+	if (clock->measured) {
+		dev->drain.stats.rate_mhz = HRC_ClockRateMilliHz(clock);
+		dev->drain.stats.drift_ppm = HRC_ClockDriftPpm(clock);
 	}
-	gettimeofday(&endtime, 0x0);
-	timeval_subtract(&timediff, &endtime, &starttime);
-
-	HRC_ReadBlockFromSensor(file, HRC_FIFO_DATA_REG, (uint8_t*) & my_data.longs[ 0], 16);
-	HRC_ReadBlockFromSensor(file, HRC_FIFO_DATA_REG, (uint8_t*) & my_data.longs[ 4], 16);
-	HRC_ReadBlockFromSensor(file, HRC_FIFO_DATA_REG, (uint8_t*) & my_data.longs[ 8], 16);
-	HRC_ReadBlockFromSensor(file, HRC_FIFO_DATA_REG, (uint8_t*) & my_data.longs[12], 16);
-
-	string[0]=0;
-	for (ix = 0; ix < 16; ix++) {
-		sub_string[0] = 0;
-		sprintf(sub_string, "%d ", my_data.sample[ix].red);
-		strcat(string,sub_string);
+
+	for (ix = 0; ix < count; ix++) {
+		batch[ix].timestamp_ns = times[ix];
+		batch[ix].ir = dev->data.sample[ix].ir;
+		batch[ix].red = dev->data.sample[ix].red;
+		batch[ix].lost = 0;
+		batch[ix].spo2 = dev->drain.spo2;
 	}
-	string_length = strlen(string);
+	batch[0].lost = lost < UINT16_MAX ? lost : UINT16_MAX;
+	HRC_RingPush(&dev->ring, batch, count);
+	HRC_STATS_STOP(HRC_STAGE_DRAIN, start);
+
+	HRC_DrainSwitch(dev);
 
-	// To delete the last " "(0x20) 
-	string_length--;
-	string[string_length]=0; 
+	return count;
+}
 
-	//SendDataToWebsocketClient(string, string_length);
+void HRC_Run(HRC_DEVICE *dev) {
+	while (HRC_IrqWait(&dev->irq, dev, HRC_IRQ_TIMEOUT_MS) == 0);
 
-	data_ready = 1;
+	HRC_Drain(dev);
 }
 
-int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y) {
-	/* Perform the carry for the later subtraction by updating y. */
-	if (x->tv_usec < y->tv_usec) {
-		int nsec = (y->tv_usec - x->tv_usec) / 1000000 + 1;
-		y->tv_usec -= 1000000 * nsec;
-		y->tv_sec += nsec;
+void HRC_SetWaveformSink(HRC_DEVICE *dev, HRC_WAVEFORM_SINK sink, void *context) {
+	// the next block starts with the next sample, numbered on from the last one
+	HRC_CodecInit(&dev->codec, dev->codec.seq);
+	dev->waveform_context = context;
+	dev->waveform_sink = sink;
+}
+
+// Runs up to HRC_HR_BLOCK samples scaled to 16 bits through the estimators,
+// every beat closes one SpO2 window
+static void HRC_ProcessEstimators(HRC_DEVICE *dev, const uint16_t *ir, const uint16_t *red, uint16_t count) {
+	uint16_t beats[HRC_HR_BLOCK];
+	uint16_t ix, found, next = 0;
+
+	found = HRC_HrUpdate(&dev->hr, ir, count, beats);
+	for (ix = 0; ix < count; ix++) {
+		HRC_Spo2Update(&dev->spo2, red[ix], ir[ix]);
+		if (next < found && beats[next] == ix) {
+			HRC_Spo2Beat(&dev->spo2);
+			next++;
+		}
 	}
-	if (x->tv_usec - y->tv_usec > 1000000) {
-		int nsec = (y->tv_usec - x->tv_usec) / 1000000;
-		y->tv_usec += 1000000 * nsec;
-		y->tv_sec -= nsec;
+}
+
+// Short gaps are bridged with the last sample, so that beat intervals keep their
+// length; after a longer one the estimators start over. The waveform is not
+// padded, its block sequence skips a number instead.
+static void HRC_ProcessGap(HRC_DEVICE *dev, uint32_t lost, uint8_t *block, size_t size) {
+	uint16_t ir[HRC_HR_BLOCK], red[HRC_HR_BLOCK];
+	uint32_t ix, n;
+	int length;
+
+	if (lost > (uint32_t) dev->format.rate * HRC_GAP_HOLD_MS / 1000) {
+		HRC_HrRestart(&dev->hr);
+		HRC_Spo2Init(&dev->spo2, dev->format.rate);
+	} else if (dev->held.valid) {
+		for (ix = 0; ix < HRC_HR_BLOCK; ix++) {
+			ir[ix] = dev->held.ir;
+			red[ix] = dev->held.red;
+		}
+		for (ix = 0; ix < lost; ix += n) {
+			n = lost - ix < HRC_HR_BLOCK ? lost - ix : HRC_HR_BLOCK;
+			HRC_ProcessEstimators(dev, ir, red, n);
+		}
 	}
 
-	/* Compute the time remaining to wait.
-	   tv_usec is certainly positive. */
-	result->tv_sec = x->tv_sec - y->tv_sec;
-	result->tv_usec = x->tv_usec - y->tv_usec;//FILE *fd;
+	if (dev->waveform_sink) {
+		if ((length = HRC_CodecFlush(&dev->codec, block, size)) > 0)
+			dev->waveform_sink(block, length, &dev->format, dev->waveform_context);
+		dev->codec.seq++;
+	}
+}
 
-	/* Return 1 if result is negative. */
-	return x->tv_sec < y->tv_sec;
+// From here on the samples come at another rate or resolution. The waveform
+// block ends with the old format; the estimators carry on, their input being
+// scaled to 16 bits whatever the resolution.
+static void HRC_ProcessFormat(HRC_DEVICE *dev, uint8_t spo2, uint8_t *block, size_t size) {
+	int length;
+
+	if (dev->waveform_sink && (length = HRC_CodecFlush(&dev->codec, block, size)) > 0)
+		dev->waveform_sink(block, length, &dev->format, dev->waveform_context);
+
+	HRC_SampleFormat(spo2, &dev->format);
+	HRC_HrSetRate(&dev->hr, dev->format.rate);
+	HRC_Spo2SetRate(&dev->spo2, dev->format.rate);
+}
+
+void HRC_Process(HRC_DEVICE *dev) {
+	// HRC_Process of all devices runs on one thread
+	static uint8_t block[HRC_CODEC_MAX_BLOCK_SIZE(HRC_CODEC_BLOCK)];
+	HRC_RING_SAMPLE batch[HRC_HR_BLOCK];
+	uint16_t ir[HRC_HR_BLOCK], red[HRC_HR_BLOCK];
+	uint32_t count, ix, run, n;
+	uint8_t shift;
+	int length;
+
+	while ((count = HRC_RingPop(&dev->ring, batch, sizeof(batch) / sizeof(batch[0]))) > 0) {
+		HRC_STATS_START(start);
+		// runs of one format without a gap go through the estimators as a block
+		for (run = 0; run < count; run += n) {
+			if (batch[run].spo2 != dev->format.spo2)
+				HRC_ProcessFormat(dev, batch[run].spo2, block, sizeof(block));
+			if (batch[run].lost)
+				HRC_ProcessGap(dev, batch[run].lost, block, sizeof(block));
+
+			shift = 16 - dev->format.bits;
+			for (n = 0, ix = run; ix < count; n++, ix++) {
+				if (n && (batch[ix].spo2 != dev->format.spo2 || batch[ix].lost))
+					break;
+				ir[n] = batch[ix].ir << shift;
+				red[n] = batch[ix].red << shift;
+
+				if (dev->waveform_sink &&
+						(length = HRC_CodecPush(&dev->codec, batch[ix].ir, batch[ix].red, block, sizeof(block))) > 0)
+					dev->waveform_sink(block, length, &dev->format, dev->waveform_context);
+			}
+			HRC_ProcessEstimators(dev, ir, red, n);
+		}
+		dev->held.valid = true;
+		dev->held.ir = ir[n - 1];
+		dev->held.red = red[n - 1];
+		HRC_STATS_STOP(HRC_STAGE_DSP, start);
+	}
 }
 
@@ -46,6 +46,8 @@
 #define HRC_TEMP_EN          0x08
 #define HRC_HR_ONLY          0x02
 #define HRC_SPO2_EN          0x03
+#define HRC_RESET            0x40
+#define HRC_SHDN             0x80
 
 // SpO2 configuration bits
 #define HRC_SPO2_HI_RES_EN   0x40
@@ -76,6 +78,7 @@
 #define HRC_PULSE_WIDTH_400  0x01 // 14-bit ADC resolution
 #define HRC_PULSE_WIDTH_800  0x02 // 15-bit ADC resolution
 #define HRC_PULSE_WIDTH_1600 0x03 // 16-bit ADC resolution
+#define HRC_DEFAULT_SPO2     (HRC_SAMPLES_400 | HRC_PULSE_WIDTH_800) // selected by HRC_Initialize
 
 // LED current control bits [ma]
 #define HRC_IR_CURRENT_MASK  0x0F // mask
@@ -20,6 +20,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
 
 #include <linux/types.h>
 #include <linux/i2c.h>
@@ -33,12 +35,22 @@
 #include <unistd.h>
 
 #include "HRC_defines.h"
+#include "HRC_driver.h"
+#include "HRC_transport.h"
+#include "HRC_dsp.h"
+#include "HRC_stats.h"
 
-int i2c_file;
+// failed bus transactions; the acquisition thread counts too
+static atomic_uint i2c_errors;
+
+uint32_t HRC_I2CErrors(void) {
+	return atomic_load_explicit(&i2c_errors, memory_order_relaxed);
+}
 
 __s32 I2C_smbus_access(int file, char read_write, __u8 slave_register,
 		int size, union i2c_smbus_data *data, uint8_t N) {
 	struct i2c_smbus_ioctl_data args;
+	__s32 rc;
 
 	if (size == I2C_SMBUS_I2C_BLOCK_DATA) data->block[0] = N;
 	args.read_write = read_write;
@@ -46,7 +58,12 @@ __s32 I2C_smbus_access(int file, char read_write, __u8 slave_register,
 	args.size = size;
 	args.data = data;
 
-	return ioctl(file, I2C_SMBUS, &args);
+	HRC_STATS_START(start);
+	rc = ioctl(file, I2C_SMBUS, &args);
+	HRC_STATS_STOP(HRC_STAGE_I2C, start);
+	if (rc < 0)
+		atomic_fetch_add_explicit(&i2c_errors, 1, memory_order_relaxed);
+	return rc;
 }
 
 __s32 I2C_smbus_read_byte_data(int file, __u8 slave_register) {
@@ -70,6 +87,65 @@ __s32 I2C_smbus_read_block_data(int file, __u8 slave_register, uint8_t N, uint8_
 	}
 }
 
+// Register address write followed by a repeated-start read of `len` bytes, in one ioctl
+__s32 I2C_rdwr_read(int file, __u16 slave_addr, __u8 slave_register, uint8_t *buf, uint16_t len) {
+	struct i2c_msg msgs[2];
+	struct i2c_rdwr_ioctl_data args;
+	int rc;
+
+	msgs[0].addr = slave_addr;
+	msgs[0].flags = 0;
+	msgs[0].len = 1;
+	msgs[0].buf = &slave_register;
+
+	msgs[1].addr = slave_addr;
+	msgs[1].flags = I2C_M_RD;
+	msgs[1].len = len;
+	msgs[1].buf = buf;
+
+	args.msgs = msgs;
+	args.nmsgs = 2;
+
+	HRC_STATS_START(start);
+	rc = ioctl(file, I2C_RDWR, &args);
+	HRC_STATS_STOP(HRC_STAGE_I2C, start);
+	if (rc != 2) {
+		atomic_fetch_add_explicit(&i2c_errors, 1, memory_order_relaxed);
+		return -1;
+	}
+	return 0;
+}
+
+// n single register writes chained with repeated starts, in one ioctl
+__s32 I2C_rdwr_write_regs(int file, __u16 slave_addr, const uint8_t (*pairs)[2], uint8_t n) {
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	struct i2c_rdwr_ioctl_data args;
+	uint8_t i;
+	int rc;
+
+	if (n > I2C_RDWR_IOCTL_MAX_MSGS)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		msgs[i].addr = slave_addr;
+		msgs[i].flags = 0;
+		msgs[i].len = 2;
+		msgs[i].buf = (__u8 *) pairs[i];
+	}
+
+	args.msgs = msgs;
+	args.nmsgs = n;
+
+	HRC_STATS_START(start);
+	rc = ioctl(file, I2C_RDWR, &args);
+	HRC_STATS_STOP(HRC_STAGE_I2C, start);
+	if (rc != n) {
+		atomic_fetch_add_explicit(&i2c_errors, 1, memory_order_relaxed);
+		return -1;
+	}
+	return 0;
+}
+
 bool I2C_smbus_write_byte_data(int file, __u8 slave_register, uint8_t write_data_byte) {
 	union i2c_smbus_data data;
 	data.byte = write_data_byte;
@@ -80,44 +156,486 @@ bool I2C_smbus_write_byte_data(int file, __u8 slave_register, uint8_t write_data
 		return true;
 }
 
-void HRC_SendToSensor(int file, uint8_t slave_reg, uint8_t data) {
-	I2C_smbus_write_byte_data(file, slave_reg, data);
+static int I2C_transport_read_byte(int file, uint8_t slave_register) {
+	return I2C_smbus_read_byte_data(file, slave_register);
 }
 
-uint8_t HRC_ReadFromSensor(int file, uint8_t slave_register) {
-	return I2C_smbus_read_byte_data(file, slave_register);
+static int I2C_transport_write_byte(int file, uint8_t slave_register, uint8_t data) {
+	return I2C_smbus_write_byte_data(file, slave_register, data) ? 0 : -1;
 }
 
-uint32_t HRC_ReadBlockFromSensor(int file, uint8_t slave_register, uint8_t *block, uint8_t N) {
+static int I2C_transport_read_block(int file, uint8_t slave_register, uint8_t *block, uint8_t N) {
 	return I2C_smbus_read_block_data(file, slave_register, N, block);
 }
 
-uint8_t HRC_Get(int file, uint8_t anID) {
-	return HRC_ReadFromSensor(file, anID);
+// I2C_RDWR addresses each message itself, so remember what I2C_SLAVE was set to
+#define I2C_MAX_DEVICES 8
+
+static struct {
+	int file;
+	uint8_t slave_addr;
+} i2c_devices[I2C_MAX_DEVICES];
+
+static uint8_t I2C_slave_address(int file) {
+	int i;
+
+	for (i = 0; i < I2C_MAX_DEVICES; i++)
+		if (i2c_devices[i].slave_addr && i2c_devices[i].file == file)
+			return i2c_devices[i].slave_addr;
+	return HRC_I2C_ADR;
+}
+
+int HRC_I2COpen(const char *path, uint8_t slave_addr) {
+	int file, i;
+
+	file = open(path, O_RDWR);
+	if (file < 0)
+		return -1;
+
+	if (ioctl(file, I2C_SLAVE, slave_addr) < 0) {
+		int saved = errno;
+		close(file);
+		errno = saved;
+		return -1;
+	}
+
+	for (i = 0; i < I2C_MAX_DEVICES; i++) {
+		if (i2c_devices[i].slave_addr == 0 || i2c_devices[i].file == file) {
+			i2c_devices[i].file = file;
+			i2c_devices[i].slave_addr = slave_addr;
+			break;
+		}
+	}
+
+	return file;
+}
+
+static void I2C_transport_close(int file) {
+	int i;
+
+	for (i = 0; i < I2C_MAX_DEVICES; i++)
+		if (i2c_devices[i].file == file)
+			i2c_devices[i].slave_addr = 0;
+	close(file);
+}
+
+static int I2C_transport_read_burst(int file, uint8_t slave_register, uint8_t *buf, uint16_t len) {
+	return I2C_rdwr_read(file, I2C_slave_address(file), slave_register, buf, len);
+}
+
+static int I2C_transport_write_regs(int file, const uint8_t (*pairs)[2], uint8_t n) {
+	return I2C_rdwr_write_regs(file, I2C_slave_address(file), pairs, n);
+}
+
+const HRC_TRANSPORT HRC_TransportI2C = {
+	.name = "i2c-dev",
+	.read_byte = I2C_transport_read_byte,
+	.write_byte = I2C_transport_write_byte,
+	.read_block = I2C_transport_read_block,
+	.read_burst = I2C_transport_read_burst,
+	.write_regs = I2C_transport_write_regs,
+	.close = I2C_transport_close,
+};
+
+static const uint8_t hrc_config_regs[4] = {
+	HRC_MODE_CONFIG, HRC_SPO2_CONFIG, HRC_LED_CONFIG, HRC_INT_ENABLE
+};
+
+// TEMP_EN and RESET clear themselves, so they are never part of the shadow
+static uint8_t *HRC_ConfigField(HRC_CONFIG *cfg, uint8_t ix) {
+	switch (ix) {
+	case 0: return &cfg->mode;
+	case 1: return &cfg->spo2;
+	case 2: return &cfg->led;
+	default: return &cfg->int_enable;
+	}
+}
+
+static uint8_t HRC_ConfigMask(uint8_t ix) {
+	return ix == 0 ? (uint8_t) ~(HRC_TEMP_EN | HRC_RESET) : 0xFF;
 }
 
-uint8_t HRC_GetRevisionID(int file) {
-	return HRC_ReadFromSensor(file, HRC_REVISION_ID);
+void HRC_DeviceInit(HRC_DEVICE *dev, const char *name, const HRC_TRANSPORT *transport, int file, HRC_BUS *bus) {
+	memset(dev, 0, sizeof(*dev));
+	snprintf(dev->name, sizeof(dev->name), "%s", name);
+	dev->transport = transport;
+	dev->file = file;
+	dev->bus = bus;
+	HRC_IrqOpenPoll(&dev->irq, HRC_IRQ_POLL_US);
+	HRC_RingInit(&dev->ring);
+	HRC_DrainInit(dev, HRC_DEFAULT_SPO2);
 }
 
-uint8_t HRC_GetPartID(int file) {
-	return HRC_ReadFromSensor(file, HRC_PART_ID);
+void HRC_DeviceClose(HRC_DEVICE *dev) {
+	HRC_IrqClose(&dev->irq);
+	if (dev->file >= 0 && dev->transport->close)
+		dev->transport->close(dev->file);
+	dev->file = -1;
 }
 
-INT_STATUS_BITS HRC_GetStatus(int file) {
+// Each transaction is a job on the bus of its own, unless the caller holds the
+// bus already. Wire bytes: address, register, and for reads the repeated address.
+static int HRC_BusReadByte(HRC_DEVICE *dev, uint8_t slave_register) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = dev->transport->read_byte(dev->file, slave_register);
+	HRC_BusUnlock(dev->bus, 4);
+	return rc;
+}
+
+static int HRC_BusWriteByte(HRC_DEVICE *dev, uint8_t slave_register, uint8_t data) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = dev->transport->write_byte(dev->file, slave_register, data);
+	HRC_BusUnlock(dev->bus, 3);
+	return rc;
+}
+
+static int HRC_BusReadBlock(HRC_DEVICE *dev, uint8_t slave_register, uint8_t *block, uint8_t N) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = dev->transport->read_block(dev->file, slave_register, block, N);
+	HRC_BusUnlock(dev->bus, 3 + N);
+	return rc;
+}
+
+static int HRC_BusReadBurst(HRC_DEVICE *dev, uint8_t slave_register, uint8_t *buf, uint16_t len) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = dev->transport->read_burst(dev->file, slave_register, buf, len);
+	HRC_BusUnlock(dev->bus, 3 + len);
+	return rc;
+}
+
+static int HRC_BusWriteRegs(HRC_DEVICE *dev, const uint8_t (*pairs)[2], uint8_t n) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = dev->transport->write_regs(dev->file, pairs, n);
+	HRC_BusUnlock(dev->bus, 3 * n);
+	return rc;
+}
+
+void HRC_SendToSensor(HRC_DEVICE *dev, uint8_t slave_reg, uint8_t data) {
+	HRC_BusWriteByte(dev, slave_reg, data);
+}
+
+uint8_t HRC_ReadFromSensor(HRC_DEVICE *dev, uint8_t slave_register) {
+	return HRC_BusReadByte(dev, slave_register);
+}
+
+uint32_t HRC_ReadBlockFromSensor(HRC_DEVICE *dev, uint8_t slave_register, uint8_t *block, uint8_t N) {
+	return HRC_BusReadBlock(dev, slave_register, block, N);
+}
+
+// The shadow is read and written with the bus held, HRC_SwitchFormat runs on
+// the acquisition thread while the others run on the main thread
+static int HRC_ReadConfig(HRC_DEVICE *dev, HRC_CONFIG *cfg) {
+	HRC_CONFIG loaded;
+	uint8_t regs[HRC_SPO2_CONFIG - HRC_MODE_CONFIG + 1];
+	int value;
+
+	// MODE_CONFIG and SPO2_CONFIG are adjacent
+	if (HRC_BusReadBlock(dev, HRC_MODE_CONFIG, regs, sizeof(regs)) < 0)
+		return -1;
+	loaded.mode = regs[0] & HRC_ConfigMask(0);
+	loaded.spo2 = regs[1];
+
+	if ((value = HRC_BusReadByte(dev, HRC_LED_CONFIG)) < 0)
+		return -1;
+	loaded.led = value;
+
+	if ((value = HRC_BusReadByte(dev, HRC_INT_ENABLE)) < 0)
+		return -1;
+	loaded.int_enable = value;
+
+	dev->shadow = loaded;
+	dev->shadow_valid = true;
+	if (cfg != NULL)
+		*cfg = loaded;
+
+	return 0;
+}
+
+int HRC_LoadConfig(HRC_DEVICE *dev, HRC_CONFIG *cfg) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = HRC_ReadConfig(dev, cfg);
+	HRC_BusUnlock(dev->bus, 0);
+	return rc;
+}
+
+int HRC_GetShadowConfig(HRC_DEVICE *dev, HRC_CONFIG *cfg) {
+	int rc = 0;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	if (!dev->shadow_valid)
+		rc = HRC_ReadConfig(dev, cfg);
+	else
+		*cfg = dev->shadow;
+	HRC_BusUnlock(dev->bus, 0);
+	return rc;
+}
+
+static int HRC_WriteConfig(HRC_DEVICE *dev, const HRC_CONFIG *cfg, bool verify) {
+	HRC_CONFIG target = *cfg;
+	uint8_t pairs[4][2];
+	uint8_t ix, n = 0, written = 0;
+	int value;
+
+	if (!dev->shadow_valid && HRC_ReadConfig(dev, NULL) < 0)
+		return -1;
+
+	for (ix = 0; ix < 4; ix++) {
+		uint8_t want = *HRC_ConfigField(&target, ix) & HRC_ConfigMask(ix);
+
+		if (want == *HRC_ConfigField(&dev->shadow, ix))
+			continue;
+		pairs[n][0] = hrc_config_regs[ix];
+		pairs[n][1] = want;
+		n++;
+		written |= 1 << ix;
+	}
+
+	if (n == 0)
+		return 0;
+
+#ifdef HRC_DEBUG
+	for (ix = 0; ix < n; ix++)
+		printf("Send to Sensor Reg:%02x Data:%02x\n", pairs[ix][0], pairs[ix][1]);
+#endif
+
+	if (HRC_BusWriteRegs(dev, (const uint8_t (*)[2]) pairs, n) < 0) {
+		// some of the writes may have landed
+		dev->shadow_valid = false;
+		return -1;
+	}
+
+	// the others may have changed since cfg was taken from the shadow
+	for (ix = 0; ix < 4; ix++)
+		if (written & (1 << ix))
+			*HRC_ConfigField(&dev->shadow, ix) = *HRC_ConfigField(&target, ix) & HRC_ConfigMask(ix);
+
+	if (!verify)
+		return n;
+
+	for (ix = 0; ix < 4; ix++) {
+		value = HRC_BusReadByte(dev, hrc_config_regs[ix]);
+		if (value < 0 || (value & HRC_ConfigMask(ix)) != *HRC_ConfigField(&dev->shadow, ix)) {
+			printf("HRC: register %02x reads back %02x, expected %02x\n",
+					hrc_config_regs[ix], value, *HRC_ConfigField(&dev->shadow, ix));
+			dev->shadow_valid = false;
+			return -1;
+		}
+	}
+
+	return n;
+}
+
+int HRC_ApplyConfig(HRC_DEVICE *dev, const HRC_CONFIG *cfg, bool verify) {
+	int rc;
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	rc = HRC_WriteConfig(dev, cfg, verify);
+	HRC_BusUnlock(dev->bus, 0);
+	return rc;
+}
+
+uint16_t HRC_SampleRate(uint8_t spo2_config) {
+	static const uint16_t rates[8] = { 50, 100, 167, 200, 400, 600, 800, 1000 };
+
+	return rates[(spo2_config & HRC_SAMPLES_MASK) >> 2];
+}
+
+void HRC_SampleFormat(uint8_t spo2_config, HRC_SAMPLE_FORMAT *format) {
+	format->spo2 = spo2_config & (HRC_SAMPLES_MASK | HRC_PULSE_WIDTH_MASK);
+	format->rate = HRC_SampleRate(spo2_config);
+	// each doubling of the pulse width adds a bit
+	format->bits = 13 + (spo2_config & HRC_PULSE_WIDTH_MASK);
+}
+
+int HRC_SwitchFormat(HRC_DEVICE *dev, uint8_t spo2_config) {
+	const uint8_t fields = HRC_SAMPLES_MASK | HRC_PULSE_WIDTH_MASK;
+	HRC_CONFIG cfg;
+	uint8_t pairs[4][2] = {
+		{ HRC_SPO2_CONFIG, 0 },
+		{ HRC_FIFO_WRITE_PTR, 0 },
+		{ HRC_OVER_FLOW_CNT, 0 },
+		{ HRC_FIFO_READ_PTR, 0 },
+	};
+
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	if (HRC_GetShadowConfig(dev, &cfg) < 0) {
+		HRC_BusUnlock(dev->bus, 0);
+		return -1;
+	}
+	pairs[0][1] = (cfg.spo2 & ~fields) | (spo2_config & fields);
+
+	if (HRC_BusWriteRegs(dev, (const uint8_t (*)[2]) pairs, 4) < 0) {
+		dev->shadow_valid = false;
+		HRC_BusUnlock(dev->bus, 0);
+		return -1;
+	}
+	dev->shadow.spo2 = pairs[0][1];
+	HRC_BusUnlock(dev->bus, 0);
+
+	return pairs[0][1];
+}
+
+// Sets the fields in mask of the request not yet taken, or of the current
+// format when there is none; the drain clears a request only once it is applied
+static void HRC_MergeFormat(HRC_DEVICE *dev, uint8_t mask, uint8_t spo2_config) {
+	unsigned int pending = atomic_load(&dev->format_request), merged;
+	uint8_t base;
+
+	do {
+		base = (pending & HRC_FORMAT_REQUEST) ? (pending & 0xFF) : dev->drain.spo2;
+		merged = HRC_FORMAT_REQUEST | (base & ~mask) | (spo2_config & mask);
+	} while (!atomic_compare_exchange_weak(&dev->format_request, &pending, merged));
+}
+
+void HRC_RequestFormat(HRC_DEVICE *dev, uint8_t spo2_config) {
+	HRC_MergeFormat(dev, HRC_SAMPLES_MASK | HRC_PULSE_WIDTH_MASK, spo2_config);
+}
+
+void HRC_StartTemperature(HRC_DEVICE *dev) {
+	HRC_CONFIG cfg;
+
+	if (atomic_load(&dev->temp.state) != HRC_TEMP_IDLE)
+		return;
+
+	// a drain may report TEMP_RDY as soon as TEMP_EN is written
+	dev->temp.start_ns = HRC_BusNowNs();
+	atomic_store(&dev->temp.state, HRC_TEMP_CONVERTING);
+
+	// one hold from the shadow read to the write, a format switch cannot come in between
+	HRC_BusLock(dev->bus, HRC_BUS_BACKGROUND, 0);
+	if (HRC_GetShadowConfig(dev, &cfg) < 0 ||
+			HRC_BusWriteByte(dev, HRC_MODE_CONFIG, cfg.mode | HRC_TEMP_EN) < 0)
+		atomic_store(&dev->temp.state, HRC_TEMP_IDLE);
+	HRC_BusUnlock(dev->bus, 0);
+}
+
+// Called with every INT_STATUS value read, from whichever thread read it
+static void HRC_TemperatureStatus(HRC_DEVICE *dev, INT_STATUS_BITS status) {
+	unsigned int converting = HRC_TEMP_CONVERTING;
+
+	if (status.TEMP_RDY)
+		atomic_compare_exchange_strong(&dev->temp.state, &converting, HRC_TEMP_READY);
+}
+
+int HRC_PollTemperature(HRC_DEVICE *dev) {
+	TEMPERATURE_VALUE temp;
+	int rc;
+
+	switch (atomic_load(&dev->temp.state)) {
+	case HRC_TEMP_READY:
+		break;
+	case HRC_TEMP_CONVERTING:
+		// no status read came along, e.g. the FIFO is not drained
+		if (HRC_BusNowNs() - dev->temp.start_ns >= HRC_TEMP_CONV_MAX_MS * 1000000ULL)
+			break;
+		return 0;
+	default:
+		return 0;
+	}
+
+	// TEMP_INTEGER and TEMP_FRACTION are adjacent, one transaction reads both
+	HRC_BusLock(dev->bus, HRC_BUS_BACKGROUND, 0);
+	rc = HRC_BusReadBlock(dev, HRC_TEMP_INTEGER, (uint8_t *) temp.byte, sizeof(temp.byte));
+	HRC_BusUnlock(dev->bus, 0);
+	if (rc < 0)
+		return -1;
+
+	dev->temp.value = temp.value;
+	atomic_store(&dev->temp.state, HRC_TEMP_IDLE);
+	return 1;
+}
+
+uint8_t HRC_Get(HRC_DEVICE *dev, uint8_t anID) {
+	return HRC_ReadFromSensor(dev, anID);
+}
+
+uint8_t HRC_GetRevisionID(HRC_DEVICE *dev) {
+	return HRC_ReadFromSensor(dev, HRC_REVISION_ID);
+}
+
+uint8_t HRC_GetPartID(HRC_DEVICE *dev) {
+	return HRC_ReadFromSensor(dev, HRC_PART_ID);
+}
+
+INT_STATUS_BITS HRC_GetStatus(HRC_DEVICE *dev) {
 	INT_STATUS_BITS status;
-	status.byte = HRC_ReadFromSensor(file, HRC_INT_STATUS);
+	int rc;
+
+	rc = HRC_BusReadByte(dev, HRC_INT_STATUS);
+	status.byte = rc;
+	if (rc >= 0)
+		HRC_TemperatureStatus(dev, status);
 	return status;
 }
 
-uint16_t HRC_ReadTemperature(int file) {
+static int HRC_DrainFifoBursts(HRC_DEVICE *dev, SAMPLE *samples, HRC_FIFO_STATE *state) {
+	uint8_t regs[HRC_FIFO_READ_PTR + 1];
+	uint8_t raw[HRC_FIFO_DEPTH * 4];
+	uint8_t count;
+
+	// INT_STATUS, INT_ENABLE, FIFO_WRITE_PTR, OVER_FLOW_CNT, FIFO_READ_PTR
+	if (HRC_BusReadBurst(dev, HRC_INT_STATUS, regs, sizeof(regs)) < 0)
+		return -1;
+	state->read_ns = HRC_BusNowNs();
+
+	state->status.byte = regs[HRC_INT_STATUS];
+	HRC_TemperatureStatus(dev, state->status);
+	state->write_ptr = regs[HRC_FIFO_WRITE_PTR] & (HRC_FIFO_DEPTH - 1);
+	state->overflow = regs[HRC_OVER_FLOW_CNT] & 0x0F;
+	state->read_ptr = regs[HRC_FIFO_READ_PTR] & (HRC_FIFO_DEPTH - 1);
+
+	// a non-zero overflow counter means the FIFO is full and the pointers are equal
+	if (state->overflow)
+		count = HRC_FIFO_DEPTH;
+	else
+		count = (state->write_ptr - state->read_ptr) & (HRC_FIFO_DEPTH - 1);
+	state->count = count;
+
+	if (count == 0)
+		return 0;
+
+	if (HRC_BusReadBurst(dev, HRC_FIFO_DATA_REG, raw, count * 4) < 0)
+		return -1;
+
+	// each sample is IR[15:8], IR[7:0], RED[15:8], RED[7:0], i.e. two
+	// big-endian words in the order of the SAMPLE fields
+	HRC_GetDsp()->unpack(raw, (uint16_t *) samples, count * 2);
+
+	return count;
+}
+
+int HRC_DrainFifo(HRC_DEVICE *dev, SAMPLE *samples, HRC_FIFO_STATE *state) {
+	int count;
+
+	// both bursts are one job, due when the FIFO fills up counting from the last drain
+	HRC_BusLock(dev->bus, HRC_BUS_DRAIN, dev->drain.last_ns + HRC_FIFO_DEPTH * (uint64_t) dev->drain.sample_ns);
+	count = HRC_DrainFifoBursts(dev, samples, state);
+	HRC_BusUnlock(dev->bus, 0);
+
+	return count;
+}
+
+HRC_Q16 HRC_TemperatureQ16(uint16_t value) {
 	TEMPERATURE_VALUE temp;
-	temp.byte[0] = HRC_ReadFromSensor(file, HRC_TEMP_INTEGER);
-	temp.byte[1] = HRC_ReadFromSensor(file, HRC_TEMP_FRACTION);
-	return temp.value;
+
+	// two's complement integer part plus 1/16 degree steps in the low nibble
+	temp.value = value;
+	return HRC_Q16_FROM_INT(temp.byte[0]) + ((temp.byte[1] & 0x0F) << 12);
 }
 
-void HRC_Reset(int file) {
+void HRC_Reset(HRC_DEVICE *dev) {
 
 	union {
 		uint8_t byte;
@@ -134,12 +652,12 @@ void HRC_Reset(int file) {
 		};
 	} configuration;
 
-	configuration.byte = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
+	configuration.byte = HRC_ReadFromSensor(dev, HRC_MODE_CONFIG);
 	configuration.B6 = 1;
-	HRC_SendToSensor(file, HRC_MODE_CONFIG, configuration.byte);
+	HRC_SendToSensor(dev, HRC_MODE_CONFIG, configuration.byte);
 
 	while (1) {
-		configuration.byte = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
+		configuration.byte = HRC_ReadFromSensor(dev, HRC_MODE_CONFIG);
 		if (configuration.B6 == 0) {
 			break;
 		}
@@ -147,80 +665,66 @@ void HRC_Reset(int file) {
 
 	usleep(50000);
 
+	// everything is back at its power-on value
+	dev->shadow_valid = false;
 }
 
-uint8_t HRC_Initialize(int file) {
-	uint8_t configuration = 0;
-
-	configuration = HRC_ReadFromSensor(file, HRC_MODE_CONFIG);
-	configuration = (configuration & ~0x07) | HRC_HR_ONLY;
-	configuration = (configuration & ~0x07) | HRC_TEMP_EN;
-	configuration = (configuration & ~0x07) | HRC_SPO2_EN;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_MODE_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_MODE_CONFIG, configuration);
-
-	configuration = HRC_ReadFromSensor(file, HRC_SPO2_CONFIG);
-	configuration |= HRC_SPO2_HI_RES_EN;
-	configuration |= HRC_SAMPLES_400;
-	configuration |= HRC_PULSE_WIDTH_800;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_SPO2_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_SPO2_CONFIG, configuration);
+uint8_t HRC_Initialize(HRC_DEVICE *dev) {
+	HRC_CONFIG cfg;
 
-	configuration = HRC_ReadFromSensor(file, HRC_LED_CONFIG);
-	configuration |= HRC_IR_CURRENT_110;
-	configuration |= HRC_RED_CURRENT_110;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_LED_CONFIG, configuration);
-	HRC_SendToSensor(file, HRC_LED_CONFIG, configuration);
+	// nothing to build the configuration on, the sensor stays as it is
+	if (HRC_LoadConfig(dev, &cfg) < 0) {
+		printf("HRC: cannot read the configuration registers\n");
+		return 0;
+	}
 
-	configuration = HRC_ReadFromSensor(file, HRC_INT_ENABLE);
-	configuration |= HRC_ENA_A_FULL;
-	configuration |= HRC_ENA_HR_RDY;
-	configuration |= HRC_ENA_SO2_RDY;
-	configuration |= HRC_ENA_TEP_RDY;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_INT_ENABLE, configuration);
-	HRC_SendToSensor(file, HRC_INT_ENABLE, configuration);
+	cfg.mode = (cfg.mode & ~0x07) | HRC_SPO2_EN;
 
-	i2c_file = file;
+	cfg.spo2 |= HRC_SPO2_HI_RES_EN;
+	cfg.spo2 |= HRC_DEFAULT_SPO2;
 
-	return configuration;
-}
+	cfg.led |= HRC_IR_CURRENT_110;
+	cfg.led |= HRC_RED_CURRENT_110;
 
-void HRC_SetSamples(uint8_t value) {
-	SPO2_CONFIGURATION_BITS configuration;
+	cfg.int_enable |= HRC_ENA_A_FULL;
+	cfg.int_enable |= HRC_ENA_HR_RDY;
+	cfg.int_enable |= HRC_ENA_SO2_RDY;
+	cfg.int_enable |= HRC_ENA_TEP_RDY;
 
-	configuration.byte = HRC_ReadFromSensor(i2c_file, HRC_SPO2_CONFIG);
-	configuration.SPO2_SR = value;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_SPO2_CONFIG, configuration.byte);
-	HRC_SendToSensor(i2c_file, HRC_SPO2_CONFIG, configuration.byte);
+	if (HRC_ApplyConfig(dev, &cfg, true) < 0) {
+		printf("HRC: configuration failed\n");
+		return 0;
+	}
 
+	return cfg.int_enable;
 }
 
-void HRC_SetPulseWidth(uint8_t value) {
-	SPO2_CONFIGURATION_BITS config;
-
-	config.byte = HRC_ReadFromSensor(i2c_file, HRC_SPO2_CONFIG);
-	config.SPO2_SR = value;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_SPO2_CONFIG, config.byte);
-	HRC_SendToSensor(i2c_file, HRC_SPO2_CONFIG, config.byte);
-
+void HRC_SetSamples(HRC_DEVICE *dev, uint8_t value) {
+	HRC_MergeFormat(dev, HRC_SAMPLES_MASK, value);
 }
 
-void HRC_SetRedLEDCurrent(uint8_t value) {
-	LED_CONFIGURATION_BITS configuration;
+void HRC_SetPulseWidth(HRC_DEVICE *dev, uint8_t value) {
+	HRC_MergeFormat(dev, HRC_PULSE_WIDTH_MASK, value);
+}
 
-	configuration.byte = HRC_ReadFromSensor(i2c_file, HRC_LED_CONFIG);
-	configuration.RED_PA = value;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_LED_CONFIG, configuration.byte);
-	HRC_SendToSensor(i2c_file, HRC_LED_CONFIG, configuration.byte);
+void HRC_SetRedLEDCurrent(HRC_DEVICE *dev, uint8_t value) {
+	HRC_CONFIG cfg;
 
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	if (HRC_GetShadowConfig(dev, &cfg) == 0) {
+		cfg.led = (cfg.led & ~HRC_RED_CURRENT_MASK) | (value & HRC_RED_CURRENT_MASK);
+		HRC_WriteConfig(dev, &cfg, false);
+	}
+	HRC_BusUnlock(dev->bus, 0);
 }
 
-void HRC_SetIRLEDCurrent(uint8_t value) {
-	LED_CONFIGURATION_BITS configuration;
-
-	configuration.byte = HRC_ReadFromSensor(i2c_file, HRC_LED_CONFIG);
-	configuration.IR_PA = value;
-	printf("Send to Sensor Reg:%02x Data:%02x\n", HRC_LED_CONFIG, configuration.byte);
-	HRC_SendToSensor(i2c_file, HRC_LED_CONFIG, configuration.byte);
+void HRC_SetIRLEDCurrent(HRC_DEVICE *dev, uint8_t value) {
+	HRC_CONFIG cfg;
 
+	HRC_BusLock(dev->bus, HRC_BUS_CONFIG, 0);
+	if (HRC_GetShadowConfig(dev, &cfg) == 0) {
+		cfg.led = (cfg.led & ~HRC_IR_CURRENT_MASK) | (value & HRC_IR_CURRENT_MASK);
+		HRC_WriteConfig(dev, &cfg, false);
+	}
+	HRC_BusUnlock(dev->bus, 0);
 }
@@ -23,8 +23,20 @@
 #ifndef __HRC_DRIVER__
 #define __HRC_DRIVER__
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 #include "HRC_defines.h"
+#include "HRC_fixed.h"
+#include "HRC_transport.h"
+#include "HRC_bus.h"
+#include "HRC_clock.h"
+#include "HRC_irq.h"
+#include "HRC_ring.h"
+#include "HRC_hr.h"
+#include "HRC_spo2.h"
+#include "HRC_codec.h"
 
 typedef struct {
 	uint16_t ir;
@@ -33,39 +45,218 @@ typedef struct {
 
 typedef union {
 	uint32_t longs[HRC_FIFO_DEPTH];
-	SAMPLE sample[HRC_FIFO_DEPTH * 4];
+	SAMPLE sample[HRC_FIFO_DEPTH];
 	uint16_t words[HRC_FIFO_DEPTH * 2];
 	uint8_t bytes[HRC_FIFO_DEPTH * 4];
 } HRC_DATA;
 
-uint8_t HRC_Get(int file, uint8_t anID);
-uint8_t HRC_GetRevisionID(int file);
-uint8_t HRC_GetPartID(int file);
-uint8_t HRC_GetConfig(int file);
-INT_STATUS_BITS HRC_GetStatus(int file);
-
-
-void HRC_SetConfiguration(int file, uint8_t cfg);
-void HRC_SetInterrupt(int file, uint8_t intrpts);
-void HRC_Reset(int file);
-uint8_t HRC_Initialize(int file);
-uint8_t HRC_ReadFromSensor(int file, uint8_t slave_register);
-uint32_t HRC_ReadBlockFromSensor(int file, uint8_t slave_register, uint8_t *block, uint8_t N);
-void HRC_SendToSensor(int file, uint8_t slave_reg, uint8_t data);
-void HRC_SetSamples(uint8_t value);
-void HRC_SetPulseWidth(uint8_t value);
-void HRC_SetRedLEDCurrent(uint8_t value);
-void HRC_SetIRLEDCurrent(uint8_t value);
-
-void HRC_Run(int file);
-void HRC_Startup(int file);
-
-// irBuff  - data from IR LED
-// redBuff - data from red LED
-uint8_t HRC_Read(int file, uint16_t* irBuff, uint16_t* redBuff);
-
-// tempValue - data from temperature sensor
-uint16_t HRC_ReadTemperature(int file);
+typedef struct {
+	INT_STATUS_BITS status; // read together with the pointers, clears the INT line
+	uint8_t write_ptr;
+	uint8_t overflow;       // samples lost since the last drain, saturates at 15
+	uint8_t read_ptr;
+	uint8_t count;          // samples pending, i.e. decoded by this drain
+	uint64_t read_ns;       // CLOCK_MONOTONIC just after status and pointers were read
+} HRC_FIFO_STATE;
+
+// Configuration registers, as held in the driver's shadow copy
+typedef struct {
+	uint8_t mode;       // HRC_MODE_CONFIG without the self-clearing TEMP_EN/RESET bits
+	uint8_t spo2;       // HRC_SPO2_CONFIG
+	uint8_t led;        // HRC_LED_CONFIG
+	uint8_t int_enable; // HRC_INT_ENABLE
+} HRC_CONFIG;
+
+// Fill the drain interval aims for, the rest of the FIFO absorbs a late wakeup
+#define HRC_DRAIN_TARGET     12
+#define HRC_DRAIN_MIN_US     1000
+// Gaps up to this long are bridged for the estimators, longer ones restart them
+#define HRC_GAP_HOLD_MS      250
+
+// Loss and fill seen by HRC_Drain, fields are updated individually by the draining thread
+typedef struct {
+	uint32_t drains;        // drains that found samples
+	uint32_t samples;
+	uint32_t overflows;     // drains that found the FIFO overflowed
+	uint32_t saturated;     // overflows past the 4 bit counter, their loss estimated from the elapsed time
+	uint32_t lost;          // samples lost in the FIFO
+	uint8_t max_fill;       // most samples one drain found
+	uint32_t interval_us;   // current HRC_DrainInterval
+	uint32_t rate_mhz;      // sample rate measured by the drain clock [mHz], 0 until measured
+	int32_t drift_ppm;      // of rate_mhz against the configured rate
+} HRC_DRAIN_STATS;
+
+// Temperature conversion as seen by dev->temp.state
+enum {
+	HRC_TEMP_IDLE,          // none running, dev->temp.value is current
+	HRC_TEMP_CONVERTING,    // TEMP_EN written, TEMP_RDY not seen yet
+	HRC_TEMP_READY          // a status read saw TEMP_RDY, the registers wait to be fetched
+};
+// Conversion time the fetch waits for when no status read reports TEMP_RDY
+#define HRC_TEMP_CONV_MAX_MS 100
+
+// Rate and resolution of a stretch of samples, from the SPO2_CONFIG they were taken with
+typedef struct {
+	uint8_t spo2;           // HRC_SAMPLES_* | HRC_PULSE_WIDTH_*
+	uint16_t rate;          // samples per second
+	uint8_t bits;           // ADC resolution, samples are right-justified
+} HRC_SAMPLE_FORMAT;
+
+// Receives each encoded waveform block (see HRC_codec.h) from HRC_Process,
+// with the format of its samples; a block never spans a format change
+typedef void (*HRC_WAVEFORM_SINK)(const uint8_t *block, size_t length, const HRC_SAMPLE_FORMAT *format, void *context);
+
+// Set in HRC_DEVICE.format_request along with the SPO2_CONFIG value asked for
+#define HRC_FORMAT_REQUEST   0x100
+
+#define HRC_MAX_DEVICES      8
+
+// One sensor and everything the driver keeps about it. Devices share no
+// state, so each can be drained from its own thread or all from one loop;
+// HRC_Drain and HRC_Process of one device must not run concurrently with
+// themselves, the ring is the only thing both touch.
+typedef struct HRC_DEVICE {
+	char name[16];                      // for messages, e.g. "hrc0"
+	const HRC_TRANSPORT *transport;
+	int file;                           // handle of the transport
+	HRC_BUS *bus;                       // shared with the other sensors on the adapter, or NULL
+	uint8_t part_id;
+	uint8_t revision_id;
+
+	HRC_CONFIG shadow;                  // what the configuration registers currently hold,
+	bool shadow_valid;                  // valid after HRC_LoadConfig
+
+	HRC_IRQ irq;
+
+	// written by any thread, taken by the thread that drains (see HRC_RequestFormat)
+	atomic_uint format_request;
+
+	// TEMP_RDY clears with the INT_STATUS read that reports it, so every status
+	// read passes it on here; the drain's status burst is the one that usually sees it
+	struct {
+		atomic_uint state;              // HRC_TEMP_*, advanced to READY by the thread that drains
+		uint64_t start_ns;              // of the running conversion
+		uint16_t value;                 // register pair last fetched, TEMP_INTEGER in the low byte
+	} temp;
+
+	// written by the thread that drains
+	HRC_DATA data;                      // samples of the last drain
+	HRC_FIFO_STATE fifo;                // status and pointers seen by the last drain
+	struct {
+		uint8_t spo2;                   // SPO2_CONFIG the FIFO currently fills with
+		uint16_t rate;                  // configured samples per second
+		uint32_t sample_ns;
+		uint64_t last_ns;               // previous drain, or the FIFO reset
+		HRC_CLOCK clock;                // timestamps the drained samples
+		HRC_DRAIN_STATS stats;
+	} drain;
+
+	HRC_RING ring;                      // drained samples waiting for HRC_Process
+
+	// written by HRC_Process
+	HRC_SAMPLE_FORMAT format;           // of the samples processed last
+	HRC_HR hr;
+	HRC_SPO2 spo2;
+	HRC_CODEC codec;                    // fed while a waveform sink is set
+	HRC_WAVEFORM_SINK waveform_sink;
+	void *waveform_context;
+	struct {                            // last sample handed to the estimators,
+		bool valid;                     // repeated over a short gap
+		uint16_t ir;
+		uint16_t red;
+	} held;
+} HRC_DEVICE;
+
+// Binds dev to an open transport handle; the INT source starts as polling.
+// bus - where its transactions are scheduled (see HRC_bus.h), NULL for none
+void HRC_DeviceInit(HRC_DEVICE *dev, const char *name, const HRC_TRANSPORT *transport, int file, HRC_BUS *bus);
+// Closes the INT source and the transport handle
+void HRC_DeviceClose(HRC_DEVICE *dev);
+
+uint8_t HRC_Get(HRC_DEVICE *dev, uint8_t anID);
+uint8_t HRC_GetRevisionID(HRC_DEVICE *dev);
+uint8_t HRC_GetPartID(HRC_DEVICE *dev);
+INT_STATUS_BITS HRC_GetStatus(HRC_DEVICE *dev);
+
+
+void HRC_Reset(HRC_DEVICE *dev);
+// Returns the interrupts enabled, 0 when the configuration could not be read or written
+uint8_t HRC_Initialize(HRC_DEVICE *dev);
+uint8_t HRC_ReadFromSensor(HRC_DEVICE *dev, uint8_t slave_register);
+uint32_t HRC_ReadBlockFromSensor(HRC_DEVICE *dev, uint8_t slave_register, uint8_t *block, uint8_t N);
+void HRC_SendToSensor(HRC_DEVICE *dev, uint8_t slave_reg, uint8_t data);
+
+// Reads the configuration registers into the shadow (and cfg when not NULL)
+int HRC_LoadConfig(HRC_DEVICE *dev, HRC_CONFIG *cfg);
+// Copy of the shadow, loaded from the sensor on first use
+int HRC_GetShadowConfig(HRC_DEVICE *dev, HRC_CONFIG *cfg);
+// Writes the registers that differ from the shadow in one bus transaction,
+// optionally reading them back. Returns the number written, or -1 on error.
+// A cfg taken from HRC_GetShadowConfig is only current while the bus is held
+// from that call on, HRC_SwitchFormat changes SPO2_CONFIG from the drain.
+int HRC_ApplyConfig(HRC_DEVICE *dev, const HRC_CONFIG *cfg, bool verify);
+// Samples per second for the HRC_SAMPLES_* field of a SPO2_CONFIG value
+uint16_t HRC_SampleRate(uint8_t spo2_config);
+// Rate and resolution of a SPO2_CONFIG value
+void HRC_SampleFormat(uint8_t spo2_config, HRC_SAMPLE_FORMAT *format);
+// Writes the sample rate and pulse width of spo2_config and empties the FIFO in
+// one bus transaction, so that no sample of the old format is left behind.
+// Returns the SPO2_CONFIG value written, or -1 on error.
+int HRC_SwitchFormat(HRC_DEVICE *dev, uint8_t spo2_config);
+// Triggers one temperature conversion unless one is running, the result lands
+// in TEMP_INTEGER/TEMP_FRACTION and is fetched by HRC_PollTemperature
+void HRC_StartTemperature(HRC_DEVICE *dev);
+// Fetches the running conversion into dev->temp.value once a status read saw
+// TEMP_RDY, or HRC_TEMP_CONV_MAX_MS after it started when none did. Never waits.
+// Returns 1 when a new value was fetched, 0 when none is due, -1 on a bus error.
+int HRC_PollTemperature(HRC_DEVICE *dev);
+
+// Asks for another sample rate and pulse width, spo2_config holding the
+// HRC_SAMPLES_* and HRC_PULSE_WIDTH_* fields. The thread that drains switches
+// right after its next drain, the samples carry the change through the ring
+// to HRC_Process; nothing restarts. A later request replaces one not yet taken.
+void HRC_RequestFormat(HRC_DEVICE *dev, uint8_t spo2_config);
+
+// value - the HRC_SAMPLES_*, HRC_PULSE_WIDTH_*, HRC_RED_CURRENT_* or HRC_IR_CURRENT_* constant.
+// Sample rate and pulse width are requested like HRC_RequestFormat, but each
+// changes only its field of a request not yet taken.
+void HRC_SetSamples(HRC_DEVICE *dev, uint8_t value);
+void HRC_SetPulseWidth(HRC_DEVICE *dev, uint8_t value);
+void HRC_SetRedLEDCurrent(HRC_DEVICE *dev, uint8_t value);
+void HRC_SetIRLEDCurrent(HRC_DEVICE *dev, uint8_t value);
+
+// Waits for the FIFO interrupt, then drains it
+void HRC_Run(HRC_DEVICE *dev);
+// Drains the FIFO into dev->ring, returns the samples moved or -1.
+// Samples lost to an overflow are added to the lost count of the first one.
+// Each sample carries the time it was taken (see HRC_clock.h) and its format.
+// Then switches to a format asked for with HRC_RequestFormat.
+int HRC_Drain(HRC_DEVICE *dev);
+
+// Sets the SPO2_CONFIG the drain interval, loss estimate and sample format start from, done by HRC_Startup
+void HRC_DrainInit(HRC_DEVICE *dev, uint8_t spo2_config);
+// Time until the FIFO holds HRC_DRAIN_TARGET samples, from the sample rate
+// corrected by the fill the last drains found. For draining without INT line.
+uint32_t HRC_DrainInterval(const HRC_DEVICE *dev);
+void HRC_GetDrainStats(const HRC_DEVICE *dev, HRC_DRAIN_STATS *stats);
+// Resets and configures the sensor and starts the drain and estimators on its
+// format. Returns 0, or -1 when the sensor could not be configured.
+int HRC_Startup(HRC_DEVICE *dev);
+// Discards what the FIFO holds, so that the next drain finds no overflow
+void HRC_ResetFifo(HRC_DEVICE *dev);
+// Runs the estimators over everything waiting in dev->ring
+void HRC_Process(HRC_DEVICE *dev);
+// sink - NULL stops the waveform output
+void HRC_SetWaveformSink(HRC_DEVICE *dev, HRC_WAVEFORM_SINK sink, void *context);
+
+// Reads status and FIFO pointers, then exactly the pending samples in one transaction.
+// samples - room for HRC_FIFO_DEPTH entries, decoded to host order
+// Returns the number of samples decoded, or -1 on a bus error.
+int HRC_DrainFifo(HRC_DEVICE *dev, SAMPLE *samples, HRC_FIFO_STATE *state);
+
+// Temperature register pair, TEMP_INTEGER in the low byte, as fetched by
+// HRC_PollTemperature, in degrees Celsius
+HRC_Q16 HRC_TemperatureQ16(uint16_t value);
 
 #endif
 
@@ -0,0 +1,201 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <sys/auxv.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "HRC_fixed.h"
+#include "HRC_dsp.h"
+
+static const HRC_DSP *hrc_dsp;
+
+static int32_t HRC_DspSat32(int64_t x) {
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t) x;
+}
+
+// Scalar kernels, also the reference the NEON ones are checked against
+
+static void HRC_DspUnpackScalar(const uint8_t *raw, uint16_t *words, uint16_t count) {
+	uint16_t i;
+
+	for (i = 0; i < count; i++)
+		words[i] = (raw[i * 2] << 8) | raw[i * 2 + 1];
+}
+
+static uint16_t HRC_DspDecimateScalar(const uint16_t *x, uint16_t count, uint16_t factor, uint32_t *y) {
+	uint16_t i, k, out = 0;
+	uint32_t sum;
+
+	for (i = 0; i + factor <= count; i += factor) {
+		sum = 0;
+		for (k = 0; k < factor; k++)
+			sum += x[i + k];
+		y[out++] = sum;
+	}
+
+	return out;
+}
+
+// The recursive filters carry a dependency from one sample to the next and
+// do not vectorize over time, both tables use these.
+
+static void HRC_DspDcRemove(HRC_DSP_DC *state, const int32_t *x, int32_t *y, uint16_t count) {
+	int32_t v, dc = state->dc;
+	uint16_t i;
+
+	if (count && !state->primed) {
+		dc = x[0];
+		state->primed = true;
+	}
+
+	for (i = 0; i < count; i++) {
+		v = x[i];
+		dc += HRC_Q30Mul(v - dc, state->alpha);
+		y[i] = v - dc;
+	}
+
+	state->dc = dc;
+}
+
+static void HRC_DspBiquad(HRC_DSP_BIQUAD *s, const int32_t *x, int32_t *y, uint16_t count) {
+	int64_t acc;
+	uint16_t i;
+
+	for (i = 0; i < count; i++) {
+		acc = (int64_t) s->b0 * x[i] + (int64_t) s->b1 * s->x1 + (int64_t) s->b2 * s->x2
+				- (int64_t) s->a1 * s->y1 - (int64_t) s->a2 * s->y2;
+		s->x2 = s->x1;
+		s->x1 = x[i];
+		s->y2 = s->y1;
+		s->y1 = HRC_DspSat32(acc >> 30);
+		y[i] = s->y1;
+	}
+}
+
+const HRC_DSP HRC_DspScalar = {
+	.name = "scalar",
+	.unpack = HRC_DspUnpackScalar,
+	.decimate = HRC_DspDecimateScalar,
+	.dc_remove = HRC_DspDcRemove,
+	.biquad = HRC_DspBiquad,
+};
+
+#if defined(__ARM_NEON)
+
+static bool HRC_DspHaveNeon(void) {
+#if defined(__aarch64__)
+	return true;
+#elif defined(HWCAP_ARM_NEON)
+	// built with -mfpu=neon, the core may still lack it
+	return (getauxval(AT_HWCAP) & HWCAP_ARM_NEON) != 0;
+#else
+	return false;
+#endif
+}
+
+static void HRC_DspUnpackNeon(const uint8_t *raw, uint16_t *words, uint16_t count) {
+	uint16_t i = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	// 8 words per step, swapping the bytes of each is the whole conversion
+	for (; i + 8 <= count; i += 8)
+		vst1q_u8((uint8_t *) &words[i], vrev16q_u8(vld1q_u8(raw + i * 2)));
+#endif
+
+	HRC_DspUnpackScalar(raw + i * 2, words + i, count - i);
+}
+
+static uint16_t HRC_DspDecimateNeon(const uint16_t *x, uint16_t count, uint16_t factor, uint32_t *y) {
+	uint32x4_t pairs;
+	uint32x2_t quads;
+	uint16_t i = 0, out = 0;
+
+	// widening moves and pairwise adds cover the factors the HR path uses at 50..400 sps
+	if (factor == 1) {
+		for (; i + 8 <= count; i += 8, out += 8) {
+			vst1q_u32(y + out, vmovl_u16(vld1_u16(x + i)));
+			vst1q_u32(y + out + 4, vmovl_u16(vld1_u16(x + i + 4)));
+		}
+	} else if (factor == 2) {
+		for (; i + 8 <= count; i += 8, out += 4)
+			vst1q_u32(y + out, vpaddlq_u16(vld1q_u16(x + i)));
+	} else if (factor == 4) {
+		for (; i + 8 <= count; i += 8, out += 2) {
+			pairs = vpaddlq_u16(vld1q_u16(x + i));
+			vst1_u32(y + out, vpadd_u32(vget_low_u32(pairs), vget_high_u32(pairs)));
+		}
+	} else if (factor == 8) {
+		for (; i + 8 <= count; i += 8, out++) {
+			pairs = vpaddlq_u16(vld1q_u16(x + i));
+			quads = vpadd_u32(vget_low_u32(pairs), vget_high_u32(pairs));
+			y[out] = vget_lane_u32(vpadd_u32(quads, quads), 0);
+		}
+	}
+
+	return out + HRC_DspDecimateScalar(x + i, count - i, factor, y + out);
+}
+
+const HRC_DSP HRC_DspNeon = {
+	.name = "neon",
+	.unpack = HRC_DspUnpackNeon,
+	.decimate = HRC_DspDecimateNeon,
+	.dc_remove = HRC_DspDcRemove,
+	.biquad = HRC_DspBiquad,
+};
+
+#endif
+
+const HRC_DSP *HRC_DspByName(const char *name) {
+	bool best = name == NULL || name[0] == 0;
+
+#if defined(__ARM_NEON)
+	if ((best || strcmp(name, HRC_DspNeon.name) == 0) && HRC_DspHaveNeon())
+		return &HRC_DspNeon;
+#endif
+	if (best || strcmp(name, HRC_DspScalar.name) == 0)
+		return &HRC_DspScalar;
+
+	return NULL;
+}
+
+void HRC_SetDsp(const HRC_DSP *dsp) {
+	hrc_dsp = dsp ? dsp : HRC_DspByName(NULL);
+}
+
+const HRC_DSP *HRC_GetDsp(void) {
+	if (hrc_dsp == NULL)
+		HRC_SetDsp(NULL);
+	return hrc_dsp;
+}
+
+void HRC_DspDcInit(HRC_DSP_DC *state, HRC_Q30 alpha) {
+	state->dc = 0;
+	state->alpha = alpha;
+	state->primed = false;
+}
@@ -0,0 +1,77 @@
+/* 
+ ** Signal processing kernels, NEON with scalar fallback
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_DSP__
+#define __HRC_DSP__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HRC_fixed.h"
+
+// Exponential baseline on Q23.8 values, y = x - dc
+typedef struct {
+	int32_t dc;          // Q23.8
+	HRC_Q30 alpha;       // 1 / time constant in samples
+	bool primed;         // dc starts at the first sample
+} HRC_DSP_DC;
+
+// Direct form I biquad on Q23.8 values
+typedef struct {
+	HRC_Q30 b0, b1, b2, a1, a2;
+	int32_t x1, x2, y1, y2;
+} HRC_DSP_BIQUAD;
+
+// All implementations give bit identical results, the integer sums do not
+// depend on the order they are taken in.
+typedef struct {
+	const char *name;
+
+	// count big-endian 16 bit words from the FIFO to host order,
+	// e.g. FIFO_DATA bytes into an array of SAMPLE
+	void (*unpack)(const uint8_t *raw, uint16_t *words, uint16_t count);
+
+	// Sums of factor consecutive samples, returns count / factor outputs,
+	// a remainder of fewer than factor samples is ignored
+	uint16_t (*decimate)(const uint16_t *x, uint16_t count, uint16_t factor, uint32_t *y);
+
+	// The recursive filters of the heart rate path (see HRC_HrUpdate),
+	// y may be x
+	void (*dc_remove)(HRC_DSP_DC *state, const int32_t *x, int32_t *y, uint16_t count);
+	void (*biquad)(HRC_DSP_BIQUAD *state, const int32_t *x, int32_t *y, uint16_t count);
+} HRC_DSP;
+
+extern const HRC_DSP HRC_DspScalar;
+#if defined(__ARM_NEON)
+extern const HRC_DSP HRC_DspNeon;
+#endif
+
+// Selects the kernels used by the driver, NULL picks the fastest the CPU supports
+void HRC_SetDsp(const HRC_DSP *dsp);
+const HRC_DSP *HRC_GetDsp(void);
+
+// name - "scalar", "neon" or NULL/"" for the fastest available;
+// NULL when the name is unknown or not supported on this CPU
+const HRC_DSP *HRC_DspByName(const char *name);
+
+void HRC_DspDcInit(HRC_DSP_DC *state, HRC_Q30 alpha);
+
+#endif
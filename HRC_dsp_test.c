@@ -0,0 +1,183 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks every kernel table the CPU supports against HRC_DspScalar on random
+// inputs, bit for bit. Built with "make dsp-test", add NEON=1 for the NEON
+// kernels, and run on the target:
+//   HRC_dsp_test [rounds] [seed]
+// Exits with 1 on the first difference.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HRC_fixed.h"
+#include "HRC_dsp.h"
+
+#define HRC_DSP_TEST_MAX     256  // longest input
+#define HRC_DSP_TEST_FACTOR  20   // 50 sps out of 1000
+
+static uint32_t hrc_dsp_test_state;
+
+// xorshift32, the same sequence for the same seed on every target
+static uint32_t HRC_DspTestRandom(void) {
+	uint32_t x = hrc_dsp_test_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return hrc_dsp_test_state = x;
+}
+
+// Mostly full scale values, now and then the extremes
+static uint16_t HRC_DspTestSample(void) {
+	switch (HRC_DspTestRandom() % 16) {
+	case 0:
+		return 0;
+	case 1:
+		return UINT16_MAX;
+	default:
+		return (uint16_t) HRC_DspTestRandom();
+	}
+}
+
+static bool HRC_DspTestUnpack(const HRC_DSP *dsp, uint16_t count) {
+	uint8_t raw[HRC_DSP_TEST_MAX * 2];
+	uint16_t ref[HRC_DSP_TEST_MAX], out[HRC_DSP_TEST_MAX];
+	uint16_t i;
+
+	for (i = 0; i < count * 2; i++)
+		raw[i] = (uint8_t) HRC_DspTestRandom();
+
+	HRC_DspScalar.unpack(raw, ref, count);
+	dsp->unpack(raw, out, count);
+
+	return memcmp(ref, out, count * sizeof(ref[0])) == 0;
+}
+
+static bool HRC_DspTestDecimate(const HRC_DSP *dsp, uint16_t count) {
+	uint16_t x[HRC_DSP_TEST_MAX];
+	uint32_t ref[HRC_DSP_TEST_MAX], out[HRC_DSP_TEST_MAX];
+	uint16_t i, factor, n_ref, n_out;
+
+	for (i = 0; i < count; i++)
+		x[i] = HRC_DspTestSample();
+
+	for (factor = 1; factor <= HRC_DSP_TEST_FACTOR; factor++) {
+		n_ref = HRC_DspScalar.decimate(x, count, factor, ref);
+		n_out = dsp->decimate(x, count, factor, out);
+		if (n_ref != n_out || memcmp(ref, out, n_ref * sizeof(ref[0])) != 0) {
+			printf("  factor %u\n", factor);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Q23.8 values and filter settings as the heart rate path uses them, the
+// state is carried over a random split of the input
+static bool HRC_DspTestFilters(const HRC_DSP *dsp, uint16_t count) {
+	int32_t x[HRC_DSP_TEST_MAX], ref[HRC_DSP_TEST_MAX], out[HRC_DSP_TEST_MAX];
+	HRC_DSP_DC dc_ref, dc_out;
+	HRC_DSP_BIQUAD bq_ref, bq_out;
+	uint16_t i, split = count ? HRC_DspTestRandom() % (count + 1) : 0;
+
+	for (i = 0; i < count; i++)
+		x[i] = (int32_t) HRC_DspTestSample() << 8;
+
+	HRC_DspDcInit(&dc_ref, HRC_DspTestRandom() & (HRC_Q30_ONE - 1));
+	dc_out = dc_ref;
+	HRC_DspScalar.dc_remove(&dc_ref, x, ref, count);
+	dsp->dc_remove(&dc_out, x, out, split);
+	dsp->dc_remove(&dc_out, x + split, out + split, count - split);
+	if (memcmp(ref, out, count * sizeof(ref[0])) != 0 || dc_ref.dc != dc_out.dc) {
+		printf("  dc_remove\n");
+		return false;
+	}
+
+	// coefficients up to +-1, unstable now and then so the sums saturate;
+	// ref and out hold the same input
+	memset(&bq_ref, 0, sizeof(bq_ref));
+	bq_ref.b0 = (int32_t) HRC_DspTestRandom() >> 1;
+	bq_ref.b1 = (int32_t) HRC_DspTestRandom() >> 1;
+	bq_ref.b2 = (int32_t) HRC_DspTestRandom() >> 1;
+	bq_ref.a1 = (int32_t) HRC_DspTestRandom() >> 1;
+	bq_ref.a2 = (int32_t) HRC_DspTestRandom() >> 2;
+	bq_out = bq_ref;
+	HRC_DspScalar.biquad(&bq_ref, ref, x, count);
+	dsp->biquad(&bq_out, out, out, split);
+	dsp->biquad(&bq_out, out + split, out + split, count - split);
+	if (memcmp(x, out, count * sizeof(x[0])) != 0 || memcmp(&bq_ref, &bq_out, sizeof(bq_ref)) != 0) {
+		printf("  biquad\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool HRC_DspTestTable(const HRC_DSP *dsp, uint32_t rounds) {
+	uint32_t round;
+	uint16_t count;
+
+	for (round = 0; round < rounds; round++) {
+		// every short length, then random ones
+		count = round <= HRC_DSP_TEST_FACTOR * 2 ? round : HRC_DspTestRandom() % (HRC_DSP_TEST_MAX + 1);
+
+		if (!HRC_DspTestUnpack(dsp, count)) {
+			printf("%s: unpack differs, round %u, %u words\n", dsp->name, round, count);
+			return false;
+		}
+		if (!HRC_DspTestDecimate(dsp, count)) {
+			printf("%s: decimate differs, round %u, %u samples\n", dsp->name, round, count);
+			return false;
+		}
+		if (!HRC_DspTestFilters(dsp, count)) {
+			printf("%s: filter differs, round %u, %u samples\n", dsp->name, round, count);
+			return false;
+		}
+	}
+
+	printf("%s: %u rounds bit identical to %s\n", dsp->name, rounds, HRC_DspScalar.name);
+	return true;
+}
+
+int main(int argc, char **argv) {
+	uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+	uint32_t seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+	const HRC_DSP *fastest = HRC_DspByName(NULL);
+
+	hrc_dsp_test_state = seed ? seed : 1;
+	printf("Seed %u, fastest kernels: %s\n", hrc_dsp_test_state, fastest->name);
+
+	// the scalar table against itself checks the harness, e.g. a split filter run
+	if (!HRC_DspTestTable(&HRC_DspScalar, rounds))
+		return 1;
+
+#if defined(__ARM_NEON)
+	if (HRC_DspByName("neon") == NULL)
+		printf("neon: built, but this CPU has no NEON\n");
+	else if (!HRC_DspTestTable(&HRC_DspNeon, rounds))
+		return 1;
+#else
+	printf("neon: not built, make NEON=1 dsp-test\n");
+#endif
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/* 
+ ** Fixed point arithmetic for sensor values and signal processing
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_FIXED__
+#define __HRC_FIXED__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The target is built for the soft-float ABI, where every float operation is
+// a library call. Values on the sampling and DSP paths use these instead.
+
+typedef int32_t HRC_Q16;   // Q15.16, sensor values and statistics
+typedef int32_t HRC_Q30;   // Q1.30, filter coefficients
+
+#define HRC_Q16_ONE          ((HRC_Q16) 1 << 16)
+#define HRC_Q30_ONE          ((HRC_Q30) 1 << 30)
+
+// For constants and init-time conversions, not for the sample path
+#define HRC_Q16_CONST(x)     ((HRC_Q16) ((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define HRC_Q30_CONST(x)     ((HRC_Q30) ((x) * 1073741824.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+#define HRC_Q16_FROM_INT(x)  ((HRC_Q16) ((x) * HRC_Q16_ONE))
+#define HRC_Q16_TO_INT(x)    ((int32_t) ((x) >> 16))
+
+static inline HRC_Q16 HRC_Q16Mul(HRC_Q16 a, HRC_Q16 b) {
+	return (HRC_Q16) (((int64_t) a * b) >> 16);
+}
+
+static inline HRC_Q16 HRC_Q16Div(HRC_Q16 a, HRC_Q16 b) {
+	return (HRC_Q16) (((int64_t) a << 16) / b);
+}
+
+// x * c with c in Q1.30, for any x scale
+static inline int32_t HRC_Q30Mul(int32_t x, HRC_Q30 c) {
+	return (int32_t) (((int64_t) x * c) >> 30);
+}
+
+// Rounded to nearest integer
+static inline int32_t HRC_Q16Round(HRC_Q16 x) {
+	return (int32_t) ((x + (HRC_Q16_ONE >> 1)) >> 16);
+}
+
+// Integer square root, floor(sqrt(x))
+uint32_t HRC_Sqrt64(uint64_t x);
+
+// Text output of these types is in HRC_text.h
+
+#endif
@@ -0,0 +1,401 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The fixed point heart rate and temperature paths against the float code
+// they replaced. Built with "make fixed-bench"; the numbers that matter come
+// from the soft-float target, a host FPU makes float look cheap:
+//   HRC_fixed_bench
+// Heart rate: simulated waveforms through the float reference and
+// HRC_HrUpdate, the estimates must agree to 1 bpm. Temperature: every
+// register value through "0.0625 *" and "%.02f" and through
+// HRC_TemperatureQ16 and HRC_TextPutQ16, the texts must agree to the
+// rounding of a tie. Exits with 1 on a disagreement.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "HRC_defines.h"
+#include "HRC_fixed.h"
+#include "HRC_text.h"
+#include "HRC_hr.h"
+#include "HRC_sim.h"
+#include "HRC_driver.h"
+
+#define HRC_FIXED_BENCH_SECONDS   120
+#define HRC_FIXED_BENCH_MIN_NS    200000000ULL  // each timing is repeated for at least this long
+
+#define HRC_FLOAT_HR_LOW_HZ        0.5f
+#define HRC_FLOAT_HR_HIGH_HZ       4.0f
+#define HRC_FLOAT_HR_DC_SECONDS    1.0f
+#define HRC_FLOAT_HR_ENV_HALF_LIFE 2.0f
+#define HRC_FLOAT_HR_THRESHOLD     0.4f
+#define HRC_FLOAT_HR_TOLERANCE     0.35f
+#define HRC_FLOAT_HR_MAX_REJECTS   4
+#define HRC_FLOAT_HR_SETTLE        2
+
+// The float heart rate estimator as it was before HRC_hr.c went fixed point
+typedef struct {
+	uint16_t decimation;
+	uint16_t phase;
+	uint32_t acc;
+	float rate;
+	float dc_alpha, dc;
+	float b0, b2, a1, a2;
+	float x1, x2, y1, y2;
+	float envelope, envelope_decay;
+	float prev, prev2;
+	uint32_t n;
+	uint32_t last_peak;
+	uint32_t refractory;
+	uint32_t intervals[HRC_HR_INTERVALS];
+	uint8_t next;
+	uint8_t filled;
+	uint32_t sum;
+	uint8_t candidates;
+	uint8_t rejects;
+	HRC_HR_RESULT result;
+} HRC_FLOAT_HR;
+
+static uint64_t HRC_FixedBenchNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void HRC_FloatHrInit(HRC_FLOAT_HR *hr, uint16_t sample_rate) {
+	float w0, alpha, a0, q, f0;
+
+	memset(hr, 0, sizeof(*hr));
+
+	hr->decimation = (sample_rate + HRC_HR_RATE / 2) / HRC_HR_RATE;
+	if (hr->decimation == 0)
+		hr->decimation = 1;
+	hr->rate = (float) sample_rate / hr->decimation;
+
+	hr->dc_alpha = 1.0f / (HRC_FLOAT_HR_DC_SECONDS * hr->rate);
+	hr->envelope_decay = expf(-logf(2.0f) / (HRC_FLOAT_HR_ENV_HALF_LIFE * hr->rate));
+	hr->refractory = (uint32_t) (hr->rate * 60 / HRC_HR_MAX_BPM);
+
+	f0 = sqrtf(HRC_FLOAT_HR_LOW_HZ * HRC_FLOAT_HR_HIGH_HZ);
+	q = f0 / (HRC_FLOAT_HR_HIGH_HZ - HRC_FLOAT_HR_LOW_HZ);
+	w0 = 2.0f * (float) M_PI * f0 / hr->rate;
+	alpha = sinf(w0) / (2.0f * q);
+	a0 = 1.0f + alpha;
+	hr->b0 = alpha / a0;
+	hr->b2 = -alpha / a0;
+	hr->a1 = -2.0f * cosf(w0) / a0;
+	hr->a2 = (1.0f - alpha) / a0;
+}
+
+static void HRC_FloatHrScore(HRC_FLOAT_HR *hr) {
+	float mean = (float) hr->sum / hr->filled;
+	float var = 0, d, cv, score;
+	uint8_t i;
+
+	for (i = 0; i < hr->filled; i++) {
+		d = hr->intervals[i] - mean;
+		var += d * d;
+	}
+	cv = sqrtf(var / hr->filled) / mean;
+
+	score = __builtin_popcount(hr->candidates) / 8.0f;
+	score *= fmaxf(0.0f, 1.0f - 3.0f * cv);
+	if (hr->filled < HRC_HR_INTERVALS / 2)
+		score *= (float) hr->filled / (HRC_HR_INTERVALS / 2);
+
+	hr->result.bpm = (uint16_t) (60.0f * hr->rate / mean + 0.5f);
+	hr->result.confidence = (uint8_t) (100.0f * score + 0.5f);
+}
+
+static bool HRC_FloatHrBeat(HRC_FLOAT_HR *hr, uint32_t at) {
+	uint32_t interval = at - hr->last_peak;
+	uint32_t min = (uint32_t) (hr->rate * 60 / HRC_HR_MAX_BPM);
+	uint32_t max = (uint32_t) (hr->rate * 60 / HRC_HR_MIN_BPM);
+	bool first = hr->last_peak == 0;
+	float mean;
+
+	hr->last_peak = at;
+	if (first)
+		return false;
+
+	if (interval >= min && interval <= max && hr->filled >= 2) {
+		mean = (float) hr->sum / hr->filled;
+		if (fabsf(interval - mean) > HRC_FLOAT_HR_TOLERANCE * mean)
+			interval = 0;
+	}
+
+	if (interval < min || interval > max) {
+		hr->candidates <<= 1;
+		if (++hr->rejects >= HRC_FLOAT_HR_MAX_REJECTS) {
+			hr->filled = 0;
+			hr->next = 0;
+			hr->sum = 0;
+			hr->rejects = 0;
+		}
+		return false;
+	}
+
+	if (hr->filled == HRC_HR_INTERVALS)
+		hr->sum -= hr->intervals[hr->next];
+	else
+		hr->filled++;
+	hr->intervals[hr->next] = interval;
+	hr->sum += interval;
+	hr->next = (hr->next + 1) & (HRC_HR_INTERVALS - 1);
+
+	hr->candidates = (hr->candidates << 1) | 1;
+	hr->rejects = 0;
+	hr->result.beats++;
+
+	HRC_FloatHrScore(hr);
+
+	return true;
+}
+
+static bool HRC_FloatHrUpdate(HRC_FLOAT_HR *hr, uint16_t ir) {
+	float x, ac, y;
+	bool beat = false;
+
+	hr->acc += ir;
+	if (++hr->phase < hr->decimation)
+		return false;
+	x = (float) hr->acc / hr->decimation;
+	hr->acc = 0;
+	hr->phase = 0;
+
+	if (hr->n++ == 0)
+		hr->dc = x;
+
+	hr->dc += (x - hr->dc) * hr->dc_alpha;
+	ac = hr->dc - x;
+
+	y = hr->b0 * ac + hr->b2 * hr->x2 - hr->a1 * hr->y1 - hr->a2 * hr->y2;
+	hr->x2 = hr->x1;
+	hr->x1 = ac;
+	hr->y2 = hr->y1;
+	hr->y1 = y;
+
+	hr->envelope = fmaxf(hr->envelope * hr->envelope_decay, fabsf(y));
+
+	if (hr->n > HRC_FLOAT_HR_SETTLE * hr->rate &&
+			hr->prev > hr->prev2 && hr->prev >= y &&
+			hr->prev > HRC_FLOAT_HR_THRESHOLD * hr->envelope &&
+			(hr->last_peak == 0 || hr->n - 1 - hr->last_peak >= hr->refractory))
+		beat = HRC_FloatHrBeat(hr, hr->n - 1);
+
+	hr->prev2 = hr->prev;
+	hr->prev = y;
+
+	if (hr->last_peak && hr->n - hr->last_peak > hr->rate * 60 / HRC_HR_MIN_BPM)
+		hr->result.confidence = 0;
+
+	return beat;
+}
+
+static void HRC_FixedBenchFloatRun(const uint16_t *ir, uint32_t count, uint16_t rate, HRC_HR_RESULT *result) {
+	HRC_FLOAT_HR hr;
+	uint32_t ix;
+
+	HRC_FloatHrInit(&hr, rate);
+	for (ix = 0; ix < count; ix++)
+		HRC_FloatHrUpdate(&hr, ir[ix]);
+	*result = hr.result;
+}
+
+static void HRC_FixedBenchFixedRun(const uint16_t *ir, uint32_t count, uint16_t rate, HRC_HR_RESULT *result) {
+	uint16_t beats[HRC_HR_BLOCK];
+	HRC_HR hr;
+	uint32_t ix, n;
+
+	HRC_HrInit(&hr, rate);
+	for (ix = 0; ix < count; ix += n) {
+		n = count - ix < HRC_HR_BLOCK ? count - ix : HRC_HR_BLOCK;
+		HRC_HrUpdate(&hr, ir + ix, n, beats);
+	}
+	HRC_HrGetResult(&hr, result);
+}
+
+// Samples per second of run over all of ir
+static double HRC_FixedBenchHrSpeed(void (*run)(const uint16_t *, uint32_t, uint16_t, HRC_HR_RESULT *),
+		const uint16_t *ir, uint32_t count, uint16_t rate) {
+	uint64_t start = HRC_FixedBenchNowNs(), elapsed, samples = 0;
+	HRC_HR_RESULT result;
+
+	do {
+		run(ir, count, rate, &result);
+		samples += count;
+		elapsed = HRC_FixedBenchNowNs() - start;
+	} while (elapsed < HRC_FIXED_BENCH_MIN_NS);
+
+	return samples * 1e9 / elapsed;
+}
+
+static bool HRC_FixedBenchHr(void) {
+	static const struct {
+		uint8_t spo2;
+		uint16_t rate;
+	} formats[] = {
+		{ HRC_SAMPLES_50 | HRC_PULSE_WIDTH_1600, 50 },
+		{ HRC_SAMPLES_100 | HRC_PULSE_WIDTH_1600, 100 },
+		{ HRC_SAMPLES_167 | HRC_PULSE_WIDTH_1600, 167 },
+		{ HRC_DEFAULT_SPO2, 400 },
+	};
+	static const double bpm[] = { 45.0, 72.0, 120.0, 180.0 };
+	static uint16_t ir[400 * HRC_FIXED_BENCH_SECONDS], red[400 * HRC_FIXED_BENCH_SECONDS];
+	HRC_SIM_CONFIG cfg = HRC_SIM_CONFIG_DEFAULT;
+	HRC_HR_RESULT ref, out;
+	double speed_ref, speed_out;
+	uint32_t f, k, count;
+	bool ok = true;
+	int file;
+
+	printf("%-4s %4s %10s %10s %10s %10s %7s\n", "sps", "bpm", "float bpm", "fixed bpm",
+			"float Ms/s", "fixed Ms/s", "speedup");
+
+	for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (k = 0; k < sizeof(bpm) / sizeof(bpm[0]); k++) {
+			cfg.heart_rate = bpm[k];
+			if ((file = HRC_SimOpen(&cfg)) < 0)
+				return false;
+			HRC_TransportSim.write_byte(file, HRC_MODE_CONFIG, HRC_SPO2_EN);
+			HRC_TransportSim.write_byte(file, HRC_SPO2_CONFIG, HRC_SPO2_HI_RES_EN | formats[f].spo2);
+			HRC_TransportSim.write_byte(file, HRC_LED_CONFIG, HRC_IR_CURRENT_110 | HRC_RED_CURRENT_110);
+			count = formats[f].rate * HRC_FIXED_BENCH_SECONDS;
+			HRC_SimWaveform(file, ir, red, count);
+			HRC_SimClose(file);
+
+			HRC_FixedBenchFloatRun(ir, count, formats[f].rate, &ref);
+			HRC_FixedBenchFixedRun(ir, count, formats[f].rate, &out);
+			speed_ref = HRC_FixedBenchHrSpeed(HRC_FixedBenchFloatRun, ir, count, formats[f].rate);
+			speed_out = HRC_FixedBenchHrSpeed(HRC_FixedBenchFixedRun, ir, count, formats[f].rate);
+
+			printf("%-4u %4.0f %10u %10u %10.2f %10.2f %6.2fx%s\n", formats[f].rate, bpm[k], ref.bpm, out.bpm,
+					speed_ref / 1e6, speed_out / 1e6, speed_out / speed_ref,
+					abs(ref.bpm - out.bpm) > 1 ? "  differs" : "");
+			if (abs(ref.bpm - out.bpm) > 1)
+				ok = false;
+		}
+	}
+
+	return ok;
+}
+
+// What a gap costs the estimator: HRC_HrInit derives the coefficients in
+// float, HRC_HrRestart keeps them
+static void HRC_FixedBenchHrInit(void) {
+	uint64_t start, calls;
+	double init, restart;
+	HRC_HR hr;
+
+	start = HRC_FixedBenchNowNs();
+	for (calls = 0; HRC_FixedBenchNowNs() - start < HRC_FIXED_BENCH_MIN_NS; calls++)
+		HRC_HrInit(&hr, 100 + (calls & 1));
+	init = (HRC_FixedBenchNowNs() - start) / (double) calls;
+
+	start = HRC_FixedBenchNowNs();
+	for (calls = 0; HRC_FixedBenchNowNs() - start < HRC_FIXED_BENCH_MIN_NS; calls++)
+		HRC_HrRestart(&hr);
+	restart = (HRC_FixedBenchNowNs() - start) / (double) calls;
+
+	printf("HRC_HrInit %.0f ns, HRC_HrRestart %.0f ns\n", init, restart);
+}
+
+// The temperature registers as HRC_ReadTemperature left them: integer
+// degrees in byte 0, 1/16 degree steps in the low nibble of byte 1
+static uint16_t HRC_FixedBenchTemperature(uint16_t ix) {
+	TEMPERATURE_VALUE temp;
+
+	temp.byte[0] = (int8_t) (ix >> 4);
+	temp.byte[1] = ix & 0x0F;
+	return temp.value;
+}
+
+static void HRC_FixedBenchFloatText(uint16_t value, char *buf, size_t size) {
+	TEMPERATURE_VALUE temp;
+
+	temp.value = value;
+	snprintf(buf, size, "%.02f", temp.byte[0] + 0.0625 * temp.byte[1]);
+}
+
+static void HRC_FixedBenchFixedText(uint16_t value, char *buf, size_t size) {
+	HRC_TEXT text;
+
+	HRC_TextInit(&text, buf, size);
+	HRC_TextPutQ16(&text, HRC_TemperatureQ16(value), 2);
+}
+
+// Conversions per second of every register value
+static double HRC_FixedBenchTextSpeed(void (*format)(uint16_t, char *, size_t)) {
+	uint64_t start = HRC_FixedBenchNowNs(), elapsed, conversions = 0;
+	volatile size_t sink = 0;
+	char buf[16];
+	uint16_t ix;
+
+	do {
+		for (ix = 0; ix < 4096; ix++) {
+			format(HRC_FixedBenchTemperature(ix), buf, sizeof(buf));
+			sink += buf[0];
+		}
+		conversions += 4096;
+		elapsed = HRC_FixedBenchNowNs() - start;
+	} while (elapsed < HRC_FIXED_BENCH_MIN_NS);
+
+	return conversions * 1e9 / elapsed;
+}
+
+static bool HRC_FixedBenchText(void) {
+	char ref[16], out[16];
+	uint16_t ix, same = 0;
+	double speed_ref, speed_out;
+	bool ok = true;
+
+	for (ix = 0; ix < 4096; ix++) {
+		HRC_FixedBenchFloatText(HRC_FixedBenchTemperature(ix), ref, sizeof(ref));
+		HRC_FixedBenchFixedText(HRC_FixedBenchTemperature(ix), out, sizeof(out));
+		if (strcmp(ref, out) == 0)
+			same++;
+		// "%.02f" rounds a tie to even, HRC_TextPutQ16 away from zero
+		else if (fabs(strtod(ref, NULL) - strtod(out, NULL)) > 0.0100001) {
+			printf("temperature %04x: \"%s\" against \"%s\"\n", HRC_FixedBenchTemperature(ix), ref, out);
+			ok = false;
+		}
+	}
+
+	speed_ref = HRC_FixedBenchTextSpeed(HRC_FixedBenchFloatText);
+	speed_out = HRC_FixedBenchTextSpeed(HRC_FixedBenchFixedText);
+	printf("temperature: 4096 values, %u texts identical, the rest a tie rounded the other way\n", same);
+	printf("temperature: float %.0f ns, fixed %.0f ns per value, %.2fx\n",
+			1e9 / speed_ref, 1e9 / speed_out, speed_out / speed_ref);
+
+	return ok;
+}
+
+int main(void) {
+	bool ok;
+
+	ok = HRC_FixedBenchHr();
+	HRC_FixedBenchHrInit();
+	ok = HRC_FixedBenchText() && ok;
+
+	return ok ? 0 : 1;
+}
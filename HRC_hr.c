@@ -0,0 +1,256 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "HRC_fixed.h"
+#include "HRC_dsp.h"
+#include "HRC_hr.h"
+
+#define HRC_HR_LOW_HZ        0.5f  // band-pass edges [Hz]
+#define HRC_HR_HIGH_HZ       4.0f
+#define HRC_HR_DC_SECONDS    1.0f  // baseline time constant
+#define HRC_HR_ENV_HALF_LIFE 2.0f  // envelope decay [s]
+#define HRC_HR_THRESHOLD     HRC_Q16_CONST(0.4)   // peak threshold relative to the envelope
+#define HRC_HR_TOLERANCE     HRC_Q16_CONST(0.35)  // accepted deviation from the mean interval
+#define HRC_HR_MAX_REJECTS   4     // consecutive rejects that restart tracking
+#define HRC_HR_SETTLE        2     // seconds before the filters are trusted
+
+// The coefficients depend on the internal rate and are worked out here in
+// float; HRC_HrRestart and HRC_HrSetRate to the same internal rate keep
+// them, everything from HRC_HrUpdate on is integer.
+void HRC_HrInit(HRC_HR *hr, uint16_t sample_rate) {
+	float rate, w0, alpha, a0, q, f0;
+
+	memset(hr, 0, sizeof(*hr));
+
+	hr->decimation = (sample_rate + HRC_HR_RATE / 2) / HRC_HR_RATE;
+	if (hr->decimation == 0)
+		hr->decimation = 1;
+	hr->rate = HRC_Q16_FROM_INT(sample_rate) / hr->decimation;
+	rate = (float) sample_rate / hr->decimation;
+
+	HRC_DspDcInit(&hr->dc, HRC_Q30_CONST(1.0f / (HRC_HR_DC_SECONDS * rate)));
+	hr->envelope_decay = HRC_Q30_CONST(expf(-logf(2.0f) / (HRC_HR_ENV_HALF_LIFE * rate)));
+	hr->refractory = (uint32_t) (((int64_t) hr->rate * 60 / HRC_HR_MAX_BPM) >> 16);
+	hr->max_interval = (uint32_t) (((int64_t) hr->rate * 60 / HRC_HR_MIN_BPM) >> 16);
+	hr->settle = (uint32_t) HRC_Q16_TO_INT(hr->rate * HRC_HR_SETTLE);
+
+	// RBJ band-pass centred on the geometric mean of the edges. The received
+	// light dips in systole; negated b coefficients invert the output, so
+	// beats are positive peaks.
+	f0 = sqrtf(HRC_HR_LOW_HZ * HRC_HR_HIGH_HZ);
+	q = f0 / (HRC_HR_HIGH_HZ - HRC_HR_LOW_HZ);
+	w0 = 2.0f * (float) M_PI * f0 / rate;
+	alpha = sinf(w0) / (2.0f * q);
+	a0 = 1.0f + alpha;
+	hr->bandpass.b0 = HRC_Q30_CONST(-alpha / a0);
+	hr->bandpass.b1 = 0;
+	hr->bandpass.b2 = HRC_Q30_CONST(alpha / a0);
+	hr->bandpass.a1 = HRC_Q30_CONST(-2.0f * cosf(w0) / a0);
+	hr->bandpass.a2 = HRC_Q30_CONST((1.0f - alpha) / a0);
+}
+
+void HRC_HrRestart(HRC_HR *hr) {
+	hr->phase = 0;
+	hr->acc = 0;
+
+	HRC_DspDcInit(&hr->dc, hr->dc.alpha);
+	hr->bandpass.x1 = hr->bandpass.x2 = 0;
+	hr->bandpass.y1 = hr->bandpass.y2 = 0;
+
+	hr->envelope = 0;
+	hr->prev = hr->prev2 = 0;
+	hr->n = 0;
+	hr->last_peak = 0;
+
+	memset(hr->intervals, 0, sizeof(hr->intervals));
+	hr->next = 0;
+	hr->filled = 0;
+	hr->sum = 0;
+	hr->candidates = 0;
+	hr->rejects = 0;
+
+	memset(&hr->result, 0, sizeof(hr->result));
+}
+
+void HRC_HrSetRate(HRC_HR *hr, uint16_t sample_rate) {
+	uint16_t decimation = (sample_rate + HRC_HR_RATE / 2) / HRC_HR_RATE;
+
+	if (decimation == 0)
+		decimation = 1;
+	if (HRC_Q16_FROM_INT(sample_rate) / decimation != hr->rate) {
+		HRC_HrInit(hr, sample_rate);
+		return;
+	}
+
+	hr->decimation = decimation;
+	hr->phase = 0;
+	hr->acc = 0;
+}
+
+static void HRC_HrScore(HRC_HR *hr) {
+	HRC_Q16 mean = (HRC_Q16) (((int64_t) hr->sum << 16) / hr->filled);
+	HRC_Q16 cv, penalty, score;
+	uint64_t var = 0;
+	int64_t d;
+	uint8_t i;
+
+	for (i = 0; i < hr->filled; i++) {
+		d = ((int64_t) hr->intervals[i] << 16) - mean;
+		var += (uint64_t) (d * d);
+	}
+	// sqrt of a Q32 variance is the deviation in Q16
+	cv = HRC_Q16Div((HRC_Q16) HRC_Sqrt64(var / hr->filled), mean);
+
+	// share of recent peaks accepted, penalised by interval spread
+	score = __builtin_popcount(hr->candidates) * (HRC_Q16_ONE / 8);
+	penalty = HRC_Q16_ONE - 3 * cv;
+	score = penalty > 0 ? HRC_Q16Mul(score, penalty) : 0;
+	if (hr->filled < HRC_HR_INTERVALS / 2)
+		score = score * hr->filled / (HRC_HR_INTERVALS / 2);
+
+	hr->result.bpm = (uint16_t) (((int64_t) hr->rate * 60 + mean / 2) / mean);
+	hr->result.confidence = (uint8_t) HRC_Q16Round(100 * score);
+}
+
+static bool HRC_HrBeat(HRC_HR *hr, uint32_t at) {
+	uint32_t interval = at - hr->last_peak;
+	bool first = hr->last_peak == 0;
+	int64_t deviation;
+
+	hr->last_peak = at;
+	if (first)
+		return false;
+
+	// |interval - mean| > tolerance * mean, scaled by filled to stay integer
+	if (interval >= hr->refractory && interval <= hr->max_interval && hr->filled >= 2) {
+		deviation = llabs((int64_t) interval * hr->filled - hr->sum);
+		if ((deviation << 16) > (int64_t) HRC_HR_TOLERANCE * hr->sum)
+			interval = 0;
+	}
+
+	if (interval < hr->refractory || interval > hr->max_interval) {
+		hr->candidates <<= 1;
+		// the rhythm changed for good, start over from the new intervals
+		if (++hr->rejects >= HRC_HR_MAX_REJECTS) {
+			hr->filled = 0;
+			hr->next = 0;
+			hr->sum = 0;
+			hr->rejects = 0;
+		}
+		return false;
+	}
+
+	if (hr->filled == HRC_HR_INTERVALS)
+		hr->sum -= hr->intervals[hr->next];
+	else
+		hr->filled++;
+	hr->intervals[hr->next] = interval;
+	hr->sum += interval;
+	hr->next = (hr->next + 1) & (HRC_HR_INTERVALS - 1);
+
+	hr->candidates = (hr->candidates << 1) | 1;
+	hr->rejects = 0;
+	hr->result.beats++;
+
+	HRC_HrScore(hr);
+
+	return true;
+}
+
+// One band-passed sample at the internal rate, returns true when it completed
+// an accepted beat
+static bool HRC_HrPeak(HRC_HR *hr, int32_t y) {
+	bool beat = false;
+
+	hr->n++;
+
+	hr->envelope = HRC_Q30Mul(hr->envelope, hr->envelope_decay);
+	if (abs(y) > hr->envelope)
+		hr->envelope = abs(y);
+
+	// prev is a local maximum above the adaptive threshold
+	if (hr->n > hr->settle &&
+			hr->prev > hr->prev2 && hr->prev >= y &&
+			hr->prev > HRC_Q16Mul(HRC_HR_THRESHOLD, hr->envelope) &&
+			(hr->last_peak == 0 || hr->n - 1 - hr->last_peak >= hr->refractory))
+		beat = HRC_HrBeat(hr, hr->n - 1);
+
+	hr->prev2 = hr->prev;
+	hr->prev = y;
+
+	// no beat for longer than the slowest accepted rhythm: signal lost
+	if (hr->last_peak && hr->n - hr->last_peak > hr->max_interval)
+		hr->result.confidence = 0;
+
+	return beat;
+}
+
+uint16_t HRC_HrUpdate(HRC_HR *hr, const uint16_t *ir, uint16_t count, uint16_t *beats) {
+	const HRC_DSP *dsp = HRC_GetDsp();
+	uint32_t sums[HRC_HR_BLOCK];
+	int32_t x[HRC_HR_BLOCK];
+	uint16_t last[HRC_HR_BLOCK];   // index of the sample that completes each sum
+	uint16_t ix = 0, n = 0, found = 0, k, aligned;
+
+	// complete the decimated sample the previous call left open
+	if (hr->phase) {
+		while (ix < count && hr->phase < hr->decimation) {
+			hr->acc += ir[ix++];
+			hr->phase++;
+		}
+		if (hr->phase < hr->decimation)
+			return 0;
+		last[n] = ix - 1;
+		sums[n++] = hr->acc;
+		hr->acc = 0;
+		hr->phase = 0;
+	}
+
+	aligned = dsp->decimate(ir + ix, count - ix, hr->decimation, sums + n);
+	for (k = 0; k < aligned; k++)
+		last[n + k] = ix + (k + 1) * hr->decimation - 1;
+	n += aligned;
+
+	// the remainder opens the next decimated sample
+	for (ix += aligned * hr->decimation; ix < count; ix++) {
+		hr->acc += ir[ix];
+		hr->phase++;
+	}
+
+	// sample counts in Q23.8
+	for (k = 0; k < n; k++)
+		x[k] = (int32_t) (((uint64_t) sums[k] << 8) / hr->decimation);
+
+	dsp->dc_remove(&hr->dc, x, x, n);
+	dsp->biquad(&hr->bandpass, x, x, n);
+
+	for (k = 0; k < n; k++)
+		if (HRC_HrPeak(hr, x[k]))
+			beats[found++] = last[k];
+
+	return found;
+}
+
+void HRC_HrGetResult(const HRC_HR *hr, HRC_HR_RESULT *result) {
+	*result = hr->result;
+}
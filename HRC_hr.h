@@ -0,0 +1,97 @@
+/* 
+ ** Streaming heart rate estimation
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_HR__
+#define __HRC_HR__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HRC_fixed.h"
+#include "HRC_dsp.h"
+
+#define HRC_HR_RATE          50   // internal processing rate after decimation [sps]
+#define HRC_HR_INTERVALS     8    // beat intervals averaged, power of two
+#define HRC_HR_MIN_BPM       30
+#define HRC_HR_MAX_BPM       200
+#define HRC_HR_BLOCK         64   // most samples per HRC_HrUpdate call
+
+typedef struct {
+	uint16_t bpm;        // beats per minute, 0 until two beats were seen
+	uint8_t confidence;  // 0..100
+	uint32_t beats;      // beats accepted since init
+} HRC_HR_RESULT;
+
+// All state is fixed size, one update costs the same whatever the history.
+// Signal values are sample counts in Q23.8, the update path uses no float.
+typedef struct {
+	// decimation of the input down to about HRC_HR_RATE
+	uint16_t decimation;
+	uint16_t phase;
+	uint32_t acc;
+	HRC_Q16 rate;            // rate after decimation [sps]
+
+	// DC removal and band-pass, run by the HRC_DSP kernels
+	HRC_DSP_DC dc;
+	HRC_DSP_BIQUAD bandpass;
+
+	// peak detection
+	int32_t envelope;
+	HRC_Q30 envelope_decay;
+	int32_t prev, prev2;
+	uint32_t n;              // decimated samples seen
+	uint32_t settle;         // n from which the filters are trusted
+	uint32_t last_peak;      // n of the last detected peak
+	uint32_t refractory;     // samples after a peak in which no other peak is taken,
+	                         // also the shortest accepted interval
+	uint32_t max_interval;   // longest accepted interval
+
+	// beat interval tracking
+	uint32_t intervals[HRC_HR_INTERVALS];
+	uint8_t next;
+	uint8_t filled;
+	uint32_t sum;
+	uint8_t candidates;      // shift register of accepted (1) / rejected (0) peaks
+	uint8_t rejects;         // consecutive rejections
+
+	HRC_HR_RESULT result;
+} HRC_HR;
+
+// Derives the coefficients for the rate in float, library calls on the
+// soft-float target; at start and from HRC_HrSetRate to another internal rate
+void HRC_HrInit(HRC_HR *hr, uint16_t sample_rate);
+
+// Forgets the signal and the beats, e.g. after a gap; keeps rate and coefficients
+void HRC_HrRestart(HRC_HR *hr);
+
+// Moves to another input rate between two samples. When it decimates to the
+// same internal rate the filters and beat history carry on, otherwise it starts over.
+void HRC_HrSetRate(HRC_HR *hr, uint16_t sample_rate);
+
+// Feeds up to HRC_HR_BLOCK IR samples at the sample_rate given to HRC_HrInit.
+// beats - room for count entries, receives the indexes into ir of the samples
+//         that completed an accepted beat, in order
+// Returns the number of beats.
+uint16_t HRC_HrUpdate(HRC_HR *hr, const uint16_t *ir, uint16_t count, uint16_t *beats);
+
+void HRC_HrGetResult(const HRC_HR *hr, HRC_HR_RESULT *result);
+
+#endif
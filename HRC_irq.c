@@ -0,0 +1,224 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include <linux/gpio.h>
+
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "HRC_driver.h"
+#include "HRC_irq.h"
+
+void HRC_IrqOpenPoll(HRC_IRQ *irq, uint32_t poll_us) {
+	irq->type = HRC_IRQ_POLL;
+	irq->fd = -1;
+	irq->poll_us = poll_us ? poll_us : HRC_IRQ_POLL_US;
+	irq->events = 0;
+	irq->timeouts = 0;
+}
+
+int HRC_IrqOpenGpio(HRC_IRQ *irq, const char *chip, unsigned int line) {
+	struct gpioevent_request req;
+	char path[64];
+	int chip_fd, rc;
+
+	if (chip[0] == '/')
+		snprintf(path, sizeof(path), "%s", chip);
+	else
+		snprintf(path, sizeof(path), "/dev/%s", chip);
+
+	chip_fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (chip_fd < 0) {
+		printf("HRC INT: cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	// INT is open-drain, active low: the falling edge marks a new interrupt
+	memset(&req, 0, sizeof(req));
+	req.lineoffset = line;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	req.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+	strncpy(req.consumer_label, "hrc-int", sizeof(req.consumer_label) - 1);
+
+	rc = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+	close(chip_fd);
+	if (rc < 0) {
+		printf("HRC INT: cannot request %s line %u: %s\n", path, line, strerror(errno));
+		return -1;
+	}
+
+	fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+
+	HRC_IrqOpenPoll(irq, HRC_IRQ_POLL_US);
+	irq->type = HRC_IRQ_GPIO;
+	irq->fd = req.fd;
+
+	return 0;
+}
+
+int HRC_IrqOpenSim(HRC_IRQ *irq, uint32_t period_us) {
+	struct itimerspec its;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		printf("HRC INT: timerfd_create failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	its.it_interval.tv_sec = period_us / 1000000;
+	its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+		printf("HRC INT: timerfd_settime failed: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	HRC_IrqOpenPoll(irq, period_us);
+	irq->type = HRC_IRQ_SIM;
+	irq->fd = fd;
+
+	return 0;
+}
+
+int HRC_IrqSetPeriod(HRC_IRQ *irq, uint32_t period_us) {
+	struct itimerspec its;
+
+	if (irq->type != HRC_IRQ_SIM)
+		return 0;
+
+	its.it_interval.tv_sec = period_us / 1000000;
+	its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(irq->fd, 0, &its, NULL) < 0) {
+		printf("HRC INT: timerfd_settime failed: %s\n", strerror(errno));
+		return -1;
+	}
+	irq->poll_us = period_us;
+
+	return 0;
+}
+
+int HRC_IrqOpen(HRC_IRQ *irq, const char *spec) {
+	char chip[48];
+	unsigned int line;
+
+	if (spec == NULL || spec[0] == 0) {
+		HRC_IrqOpenPoll(irq, HRC_IRQ_POLL_US);
+		return 0;
+	}
+
+	if (strcmp(spec, "sim") == 0) {
+		// A_FULL fires with 15 of 16 slots filled
+		return HRC_IrqOpenSim(irq, (HRC_FIFO_DEPTH - 1) * 1000000 / HRC_SampleRate(HRC_DEFAULT_SPO2));
+	}
+
+	if (sscanf(spec, "%47[^:]:%u", chip, &line) != 2) {
+		printf("HRC INT: bad line spec '%s', expected <gpiochip>:<line>\n", spec);
+		return -1;
+	}
+
+	return HRC_IrqOpenGpio(irq, chip, line);
+}
+
+void HRC_IrqClose(HRC_IRQ *irq) {
+	if (irq->fd >= 0)
+		close(irq->fd);
+	HRC_IrqOpenPoll(irq, irq->poll_us);
+}
+
+int HRC_IrqAck(HRC_IRQ *irq) {
+	struct gpioevent_data event;
+	uint64_t expirations;
+	int count = 0;
+
+	switch (irq->type) {
+	case HRC_IRQ_GPIO:
+		while (read(irq->fd, &event, sizeof(event)) == sizeof(event))
+			count++;
+		break;
+	case HRC_IRQ_SIM:
+		if (read(irq->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+			count = (int) expirations;
+		break;
+	default:
+		break;
+	}
+
+	irq->events += count;
+	return count;
+}
+
+static int64_t HRC_IrqNowMs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int HRC_IrqWait(HRC_IRQ *irq, struct HRC_DEVICE *dev, int timeout_ms) {
+	struct pollfd pfd;
+	int64_t deadline;
+	int rc;
+
+	if (irq->type == HRC_IRQ_POLL) {
+		deadline = HRC_IrqNowMs() + timeout_ms;
+		while (HRC_GetStatus(dev).A_FULL == 0) {
+			if (timeout_ms >= 0 && HRC_IrqNowMs() >= deadline) {
+				irq->timeouts++;
+				return 0;
+			}
+			usleep(irq->poll_us);
+		}
+		irq->events++;
+		return 1;
+	}
+
+	pfd.fd = irq->fd;
+	pfd.events = POLLIN | POLLPRI;
+	pfd.revents = 0;
+
+	do {
+		rc = poll(&pfd, 1, timeout_ms);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		return -1;
+
+	if (rc > 0 && HRC_IrqAck(irq) > 0)
+		return 1;
+
+	irq->timeouts++;
+
+	// An edge that fired before the line was requested is never reported,
+	// so on a GPIO timeout look at the status register before giving up.
+	if (irq->type == HRC_IRQ_GPIO && HRC_GetStatus(dev).A_FULL)
+		return 1;
+
+	return 0;
+}
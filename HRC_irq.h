@@ -0,0 +1,69 @@
+/*
+ ** HRC interrupt (INT line) handling
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_IRQ__
+#define __HRC_IRQ__
+
+#include <stdint.h>
+
+struct HRC_DEVICE;
+
+// default interval between INT_STATUS reads when no INT line is available
+#define HRC_IRQ_POLL_US      1000
+// longest wait for an edge before the status register is checked anyway
+#define HRC_IRQ_TIMEOUT_MS   1000
+
+typedef enum {
+	HRC_IRQ_POLL,   // no INT line, poll INT_STATUS.A_FULL
+	HRC_IRQ_GPIO,   // INT line through the GPIO character device
+	HRC_IRQ_SIM,    // simulated INT source (timerfd)
+} HRC_IRQ_TYPE;
+
+typedef struct {
+	HRC_IRQ_TYPE type;
+	int fd;             // line event fd / timerfd, -1 when polling
+	uint32_t poll_us;   // poll interval, also the SIM period
+	uint32_t events;    // INT edges seen
+	uint32_t timeouts;  // waits that ended without an edge
+} HRC_IRQ;
+
+#define HRC_IRQ_INITIALIZER { HRC_IRQ_POLL, -1, HRC_IRQ_POLL_US, 0, 0 }
+
+// spec - NULL/"" for polling, "sim" for the simulated source
+//        or "<gpiochip>:<line>", e.g. "gpiochip0:17" or "/dev/gpiochip1:3"
+int HRC_IrqOpen(HRC_IRQ *irq, const char *spec);
+int HRC_IrqOpenGpio(HRC_IRQ *irq, const char *chip, unsigned int line);
+int HRC_IrqOpenSim(HRC_IRQ *irq, uint32_t period_us);
+void HRC_IrqOpenPoll(HRC_IRQ *irq, uint32_t poll_us);
+void HRC_IrqClose(HRC_IRQ *irq);
+// Re-arms a simulated source with a new A_FULL period, e.g. for a new sample
+// rate; a real INT line follows the sensor, polling keeps its interval
+int HRC_IrqSetPeriod(HRC_IRQ *irq, uint32_t period_us);
+
+// Consume pending edges on irq->fd without blocking, returns number consumed
+int HRC_IrqAck(HRC_IRQ *irq);
+
+// Block until the sensor signals A_FULL or timeout_ms elapses (-1 = forever).
+// Returns 1 when the FIFO should be drained, 0 on timeout, -1 on error.
+// dev - the sensor whose INT_STATUS is read when there is no INT line
+int HRC_IrqWait(HRC_IRQ *irq, struct HRC_DEVICE *dev, int timeout_ms);
+
+#endif
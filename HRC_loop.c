@@ -0,0 +1,242 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "HRC_loop.h"
+
+#define HRC_LOOP_EVENTS      8
+
+static uint64_t HRC_LoopNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int HRC_LoopInit(HRC_LOOP *loop) {
+	memset(loop, 0, sizeof(*loop));
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0) {
+		printf("HRC loop: epoll_create1 failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+void HRC_LoopClose(HRC_LOOP *loop) {
+	uint32_t ix;
+
+	for (ix = 0; ix < loop->count; ix++)
+		if (loop->sources[ix].timer)
+			close(loop->sources[ix].fd);
+
+	if (loop->epfd >= 0)
+		close(loop->epfd);
+	loop->epfd = -1;
+	loop->count = 0;
+}
+
+static HRC_LOOP_SOURCE *HRC_LoopAdd(HRC_LOOP *loop, const char *name, int fd, bool timer,
+		HRC_LOOP_HANDLER handler, void *context) {
+	struct epoll_event event;
+	HRC_LOOP_SOURCE *source;
+
+	if (loop->count >= HRC_LOOP_MAX_SOURCES) {
+		printf("HRC loop: no room for '%s'\n", name);
+		return NULL;
+	}
+
+	source = &loop->sources[loop->count];
+	memset(source, 0, sizeof(*source));
+	source->name = name;
+	source->fd = fd;
+	source->timer = timer;
+	source->handler = handler;
+	source->context = context;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = source;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		printf("HRC loop: cannot watch '%s': %s\n", name, strerror(errno));
+		return NULL;
+	}
+
+	loop->count++;
+	return source;
+}
+
+HRC_LOOP_SOURCE *HRC_LoopAddTimer(HRC_LOOP *loop, const char *name, uint32_t period_us,
+		HRC_LOOP_HANDLER handler, void *context) {
+	HRC_LOOP_SOURCE *source;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		printf("HRC loop: timerfd_create failed: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	if ((source = HRC_LoopAdd(loop, name, fd, true, handler, context)) == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	if (HRC_LoopSetPeriod(loop, source, period_us) < 0)
+		return NULL;
+
+	return source;
+}
+
+HRC_LOOP_SOURCE *HRC_LoopAddFd(HRC_LOOP *loop, const char *name, int fd,
+		HRC_LOOP_HANDLER handler, void *context) {
+	return HRC_LoopAdd(loop, name, fd, false, handler, context);
+}
+
+int HRC_LoopSetPeriod(HRC_LOOP *loop, HRC_LOOP_SOURCE *source, uint32_t period_us) {
+	struct itimerspec its;
+	uint64_t deadline;
+
+	if (!source->timer)
+		return -1;
+
+	// Absolute deadlines on a fixed grid: a late run does not shift the ones after it
+	memset(&its, 0, sizeof(its));
+	deadline = 0;
+	if (period_us) {
+		deadline = HRC_LoopNowNs() + (uint64_t) period_us * 1000;
+		its.it_value.tv_sec = deadline / 1000000000ULL;
+		its.it_value.tv_nsec = deadline % 1000000000ULL;
+		its.it_interval.tv_sec = period_us / 1000000;
+		its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+	}
+
+	if (timerfd_settime(source->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		printf("HRC loop: cannot arm '%s': %s\n", source->name, strerror(errno));
+		return -1;
+	}
+
+	source->period_us = period_us;
+	source->deadline_ns = deadline;
+	return 0;
+}
+
+int HRC_LoopParseConfig(HRC_LOOP *loop, const char *spec) {
+	char key[16];
+	long value;
+	int consumed;
+	uint32_t ix, found;
+
+	while (spec != NULL && *spec) {
+		if (sscanf(spec, " %15[^=,]=%li%n", key, &value, &consumed) != 2 || value < 0) {
+			printf("HRC loop: cannot parse '%s'\n", spec);
+			return -1;
+		}
+
+		found = 0;
+		for (ix = 0; ix < loop->count; ix++) {
+			if (!loop->sources[ix].timer || strcmp(loop->sources[ix].name, key) != 0)
+				continue;
+			if (HRC_LoopSetPeriod(loop, &loop->sources[ix], (uint32_t) value * 1000) < 0)
+				return -1;
+			found++;
+		}
+
+		if (found == 0) {
+			printf("HRC loop: unknown timer '%s'\n", key);
+			return -1;
+		}
+
+		spec += consumed;
+		if (*spec == ',')
+			spec++;
+	}
+
+	return 0;
+}
+
+static void HRC_LoopDispatch(HRC_LOOP_SOURCE *source) {
+	uint64_t expirations, now, late_ns;
+
+	if (source->timer) {
+		if (read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0)
+			return;
+
+		// the last expiry that passed is the one this run stands for
+		now = HRC_LoopNowNs();
+		source->deadline_ns += (expirations - 1) * source->period_us * 1000ULL;
+		late_ns = now > source->deadline_ns ? now - source->deadline_ns : 0;
+		if (late_ns / 1000 > source->max_late_us)
+			source->max_late_us = late_ns / 1000;
+		source->deadline_ns += source->period_us * 1000ULL;
+		source->missed += expirations - 1;
+	}
+
+	source->runs++;
+	source->handler(source->context);
+}
+
+int HRC_LoopRun(HRC_LOOP *loop) {
+	struct epoll_event events[HRC_LOOP_EVENTS];
+	int count, ix;
+
+	while (!loop->stop) {
+		count = epoll_wait(loop->epfd, events, HRC_LOOP_EVENTS, -1);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			printf("HRC loop: epoll_wait failed: %s\n", strerror(errno));
+			return -1;
+		}
+
+		for (ix = 0; ix < count && !loop->stop; ix++)
+			HRC_LoopDispatch(events[ix].data.ptr);
+	}
+
+	return 0;
+}
+
+void HRC_LoopStop(HRC_LOOP *loop) {
+	loop->stop = 1;
+}
+
+void HRC_LoopDump(const HRC_LOOP *loop) {
+	const HRC_LOOP_SOURCE *source;
+	uint32_t ix;
+
+	printf("======== Event loop: ======== \n");
+	for (ix = 0; ix < loop->count; ix++) {
+		source = &loop->sources[ix];
+		if (source->timer)
+			printf("%-12s every %u us: %u runs, %u missed, worst %u us late\n",
+					source->name, source->period_us, source->runs, source->missed, source->max_late_us);
+		else
+			printf("%-12s fd %d: %u runs\n", source->name, source->fd, source->runs);
+	}
+	printf("============================= \n");
+}
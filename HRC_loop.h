@@ -0,0 +1,83 @@
+/*
+ ** Event loop: timerfd deadlines and readiness of other fds in one epoll set
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_LOOP__
+#define __HRC_LOOP__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+
+#define HRC_LOOP_MAX_SOURCES 32
+
+typedef void (*HRC_LOOP_HANDLER)(void *context);
+
+typedef struct {
+	const char *name;
+	int fd;                // timerfd owned by the loop, or the watched fd
+	bool timer;
+	uint32_t period_us;    // 0 while a timer is disarmed
+	uint64_t deadline_ns;  // next expiry of a timer, CLOCK_MONOTONIC
+	HRC_LOOP_HANDLER handler;
+	void *context;
+
+	uint32_t runs;         // handler calls
+	uint32_t missed;       // timer expirations folded into a later run
+	uint32_t max_late_us;  // worst handler start after the deadline
+} HRC_LOOP_SOURCE;
+
+typedef struct {
+	int epfd;
+	volatile sig_atomic_t stop;
+	uint32_t count;
+	HRC_LOOP_SOURCE sources[HRC_LOOP_MAX_SOURCES];
+} HRC_LOOP;
+
+int HRC_LoopInit(HRC_LOOP *loop);
+void HRC_LoopClose(HRC_LOOP *loop);
+
+// Calls handler every period_us, the first time one period from now.
+// A period of 0 adds the timer disarmed.
+HRC_LOOP_SOURCE *HRC_LoopAddTimer(HRC_LOOP *loop, const char *name, uint32_t period_us,
+		HRC_LOOP_HANDLER handler, void *context);
+
+// Calls handler whenever fd is readable, the fd stays owned by the caller
+HRC_LOOP_SOURCE *HRC_LoopAddFd(HRC_LOOP *loop, const char *name, int fd,
+		HRC_LOOP_HANDLER handler, void *context);
+
+// Re-arms a timer relative to now, 0 disarms it
+int HRC_LoopSetPeriod(HRC_LOOP *loop, HRC_LOOP_SOURCE *source, uint32_t period_us);
+
+// spec - comma separated timer periods in ms by source name, e.g. "dowork=100,temperature=5000";
+//        a name shared by several timers, e.g. the drain timer of each sensor, sets them all
+int HRC_LoopParseConfig(HRC_LOOP *loop, const char *spec);
+
+// Dispatches until HRC_LoopStop, returns 0 then and -1 if epoll fails.
+// The loop sleeps in epoll_wait whenever no deadline has passed and no fd is ready.
+int HRC_LoopRun(HRC_LOOP *loop);
+
+// Safe from a signal handler
+void HRC_LoopStop(HRC_LOOP *loop);
+
+// Prints the per source counters
+void HRC_LoopDump(const HRC_LOOP *loop);
+
+#endif
@@ -0,0 +1,144 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "HRC_metrics.h"
+
+// /proc/self/stat fields used, numbered as in proc(5)
+#define HRC_STAT_MINFLT      10
+#define HRC_STAT_MAJFLT      12
+#define HRC_STAT_UTIME       14
+#define HRC_STAT_STIME       15
+#define HRC_STAT_THREADS     20
+
+static uint64_t HRC_MetricsNowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// procfs regenerates the text on every read from offset 0
+static int HRC_MetricsRead(int fd, char *buf, size_t size) {
+	ssize_t n = pread(fd, buf, size - 1, 0);
+
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+	return n;
+}
+
+int HRC_MetricsOpen(HRC_METRICS *metrics) {
+	HRC_METRICS_SAMPLE sample;
+	long value;
+
+	memset(metrics, 0, sizeof(*metrics));
+	metrics->statm_fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+	metrics->stat_fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+	if (metrics->statm_fd < 0 || metrics->stat_fd < 0) {
+		printf("HRC metrics: cannot open /proc/self: %s\n", strerror(errno));
+		HRC_MetricsClose(metrics);
+		return -1;
+	}
+
+	value = sysconf(_SC_PAGESIZE);
+	metrics->page_kib = value > 0 ? value / 1024 : 4;
+	value = sysconf(_SC_CLK_TCK);
+	metrics->clock_ticks = value > 0 ? value : 100;
+
+	// the first HRC_MetricsSample reports the CPU use since now
+	if (HRC_MetricsSample(metrics, &sample) < 0) {
+		printf("HRC metrics: cannot parse /proc/self\n");
+		HRC_MetricsClose(metrics);
+		return -1;
+	}
+
+	return 0;
+}
+
+void HRC_MetricsClose(HRC_METRICS *metrics) {
+	if (metrics->statm_fd >= 0)
+		close(metrics->statm_fd);
+	if (metrics->stat_fd >= 0)
+		close(metrics->stat_fd);
+	metrics->statm_fd = -1;
+	metrics->stat_fd = -1;
+}
+
+int HRC_MetricsSample(HRC_METRICS *metrics, HRC_METRICS_SAMPLE *sample) {
+	unsigned long field[HRC_STAT_THREADS + 1];
+	unsigned long size, resident;
+	struct rusage usage;
+	char buf[512];
+	char *p, *end;
+	uint32_t ix, ticks;
+	uint64_t now;
+
+	memset(sample, 0, sizeof(*sample));
+
+	// size resident shared text lib data dt, in pages
+	if (HRC_MetricsRead(metrics->statm_fd, buf, sizeof(buf)) < 0 ||
+			sscanf(buf, "%lu %lu", &size, &resident) != 2)
+		return -1;
+
+	// pid (comm) state ppid ...; comm may hold spaces and parentheses itself
+	if (HRC_MetricsRead(metrics->stat_fd, buf, sizeof(buf)) < 0 ||
+			(p = strrchr(buf, ')')) == NULL || (p = strchr(p + 2, ' ')) == NULL)
+		return -1;
+
+	// p is past the state, field 3
+	for (ix = 4; ix <= HRC_STAT_THREADS; ix++) {
+		field[ix] = strtoul(p, &end, 10);
+		if (end == p)
+			return -1;
+		p = end;
+	}
+
+	now = HRC_MetricsNowNs();
+	ticks = field[HRC_STAT_UTIME] + field[HRC_STAT_STIME];
+
+	sample->rss_kib = resident * metrics->page_kib;
+	sample->vm_kib = size * metrics->page_kib;
+	sample->cpu_ms = (uint64_t) ticks * 1000 / metrics->clock_ticks;
+	sample->minor_faults = field[HRC_STAT_MINFLT];
+	sample->major_faults = field[HRC_STAT_MAJFLT];
+	sample->threads = field[HRC_STAT_THREADS];
+
+	if (metrics->last_ns && now > metrics->last_ns)
+		sample->cpu_permille = (uint64_t) (ticks - metrics->last_ticks) * 1000000000000ULL /
+				((uint64_t) metrics->clock_ticks * (now - metrics->last_ns));
+	metrics->last_ns = now;
+	metrics->last_ticks = ticks;
+
+	// summed over all threads, unlike /proc/self/status
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		sample->voluntary_switches = usage.ru_nvcsw;
+		sample->involuntary_switches = usage.ru_nivcsw;
+	}
+
+	return 0;
+}
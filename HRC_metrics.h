@@ -0,0 +1,58 @@
+/*
+ ** Process metrics from /proc/self
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_METRICS__
+#define __HRC_METRICS__
+
+#include <stdint.h>
+
+// /proc/self/statm and /proc/self/stat stay open, each sample is one
+// pread() per file from offset 0 plus getrusage() for the context switches.
+
+typedef struct {
+	int statm_fd;
+	int stat_fd;
+	uint32_t page_kib;
+	uint32_t clock_ticks;   // sysconf(_SC_CLK_TCK)
+	uint64_t last_ns;       // CLOCK_MONOTONIC of the previous sample
+	uint32_t last_ticks;    // utime + stime of the previous sample
+} HRC_METRICS;
+
+// Counters are totals since the process started, all threads included
+typedef struct {
+	uint32_t rss_kib;
+	uint32_t vm_kib;
+	uint32_t cpu_permille;          // CPU time per wall time since the previous sample, of one core
+	uint32_t cpu_ms;                // user + system
+	uint32_t minor_faults;
+	uint32_t major_faults;
+	uint32_t threads;
+	uint32_t voluntary_switches;    // blocked, e.g. in epoll_wait or an ioctl
+	uint32_t involuntary_switches;  // preempted
+} HRC_METRICS_SAMPLE;
+
+int HRC_MetricsOpen(HRC_METRICS *metrics);
+void HRC_MetricsClose(HRC_METRICS *metrics);
+
+// Returns 0, or -1 when /proc could not be read or parsed
+int HRC_MetricsSample(HRC_METRICS *metrics, HRC_METRICS_SAMPLE *sample);
+
+#endif
@@ -0,0 +1,131 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "HRC_ring.h"
+
+#define HRC_RING_MASK (HRC_RING_CAPACITY - 1)
+
+_Static_assert((HRC_RING_CAPACITY & HRC_RING_MASK) == 0, "HRC_RING_CAPACITY must be a power of two");
+
+void HRC_RingInit(HRC_RING *ring) {
+	atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->drops, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->high_water, 0, memory_order_relaxed);
+	ring->tail_cache = 0;
+	ring->lost_carry = 0;
+	ring->head_cache = 0;
+}
+
+// Copies n entries starting at index `from` of the ring, handling the wrap
+static void HRC_RingCopyIn(HRC_RING *ring, uint32_t from, const HRC_RING_SAMPLE *src, uint32_t n) {
+	uint32_t first = HRC_RING_CAPACITY - (from & HRC_RING_MASK);
+
+	if (first > n)
+		first = n;
+	memcpy(&ring->slots[from & HRC_RING_MASK], src, first * sizeof(*src));
+	memcpy(&ring->slots[0], src + first, (n - first) * sizeof(*src));
+}
+
+static void HRC_RingCopyOut(HRC_RING *ring, uint32_t from, HRC_RING_SAMPLE *dst, uint32_t n) {
+	uint32_t first = HRC_RING_CAPACITY - (from & HRC_RING_MASK);
+
+	if (first > n)
+		first = n;
+	memcpy(dst, &ring->slots[from & HRC_RING_MASK], first * sizeof(*dst));
+	memcpy(dst + first, &ring->slots[0], (n - first) * sizeof(*dst));
+}
+
+uint32_t HRC_RingPush(HRC_RING *ring, const HRC_RING_SAMPLE *samples, uint32_t n) {
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint32_t space = HRC_RING_CAPACITY - (head - ring->tail_cache);
+	HRC_RING_SAMPLE *slot;
+	uint32_t fill, lost, ix;
+
+	if (space < n) {
+		ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		space = HRC_RING_CAPACITY - (head - ring->tail_cache);
+	}
+
+	if (n > space)
+		atomic_fetch_add_explicit(&ring->drops, n - space, memory_order_relaxed);
+	else
+		space = n;
+
+	// the drops of earlier pushes came right before the first sample stored now
+	if (space) {
+		HRC_RingCopyIn(ring, head, samples, space);
+		if (ring->lost_carry) {
+			slot = &ring->slots[head & HRC_RING_MASK];
+			lost = slot->lost + ring->lost_carry;
+			slot->lost = lost < UINT16_MAX ? lost : UINT16_MAX;
+			ring->lost_carry = 0;
+		}
+		atomic_store_explicit(&ring->head, head + space, memory_order_release);
+
+		fill = head + space - ring->tail_cache;
+		if (fill > atomic_load_explicit(&ring->high_water, memory_order_relaxed))
+			atomic_store_explicit(&ring->high_water, fill, memory_order_relaxed);
+	}
+
+	// the newest samples dropped now come after the last one stored, together
+	// with the gaps they carried
+	for (ix = space; ix < n; ix++)
+		ring->lost_carry += 1 + samples[ix].lost;
+
+	return space;
+}
+
+uint32_t HRC_RingPop(HRC_RING *ring, HRC_RING_SAMPLE *out, uint32_t max) {
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint32_t avail = ring->head_cache - tail;
+
+	if (avail < max) {
+		ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+		avail = ring->head_cache - tail;
+	}
+
+	if (max > avail)
+		max = avail;
+
+	if (max == 0)
+		return 0;
+
+	HRC_RingCopyOut(ring, tail, out, max);
+	atomic_store_explicit(&ring->tail, tail + max, memory_order_release);
+
+	return max;
+}
+
+uint32_t HRC_RingCount(HRC_RING *ring) {
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	return head - tail;
+}
+
+uint32_t HRC_RingDrops(HRC_RING *ring) {
+	return atomic_load_explicit(&ring->drops, memory_order_relaxed);
+}
+
+uint32_t HRC_RingHighWater(HRC_RING *ring) {
+	return atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+/* 
+ ** Single producer / single consumer sample ring
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_RING__
+#define __HRC_RING__
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define HRC_RING_CAPACITY    1024  // samples, power of two
+#define HRC_CACHE_LINE       64
+
+typedef struct {
+	uint64_t timestamp_ns;  // CLOCK_MONOTONIC
+	uint16_t ir;
+	uint16_t red;
+	uint16_t lost;          // samples missing right before this one, saturates
+	uint8_t spo2;           // SPO2_CONFIG it was taken with, i.e. its rate and resolution
+} HRC_RING_SAMPLE;
+
+// The producer only writes head and its statistics, the consumer only writes
+// tail; each side keeps a private copy of the other index so that it touches
+// the shared cache line only when its copy says the ring is full/empty.
+typedef struct {
+	_Alignas(HRC_CACHE_LINE) atomic_uint head;
+	uint32_t tail_cache;
+	uint32_t lost_carry;    // drops not yet added to a pushed sample
+	atomic_uint drops;
+	atomic_uint high_water;
+
+	_Alignas(HRC_CACHE_LINE) atomic_uint tail;
+	uint32_t head_cache;
+
+	_Alignas(HRC_CACHE_LINE) HRC_RING_SAMPLE slots[HRC_RING_CAPACITY];
+} HRC_RING;
+
+void HRC_RingInit(HRC_RING *ring);
+
+// Producer side: copies up to n samples, the newest ones that do not fit are
+// counted as drops and added to the lost count of the next sample pushed by a
+// later call. Returns the number pushed.
+uint32_t HRC_RingPush(HRC_RING *ring, const HRC_RING_SAMPLE *samples, uint32_t n);
+
+// Consumer side: moves up to max samples into out, returns the number popped
+uint32_t HRC_RingPop(HRC_RING *ring, HRC_RING_SAMPLE *out, uint32_t max);
+
+// Samples waiting, safe from either side
+uint32_t HRC_RingCount(HRC_RING *ring);
+uint32_t HRC_RingDrops(HRC_RING *ring);
+uint32_t HRC_RingHighWater(HRC_RING *ring);
+
+#endif
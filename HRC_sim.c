@@ -0,0 +1,478 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "HRC_defines.h"
+#include "HRC_sim.h"
+
+#define HRC_SIM_TEMP_CONV_NS 29000000ULL  // temperature conversion time
+#define HRC_SIM_PERFUSION    0.02         // IR pulse amplitude relative to DC
+#define HRC_SIM_MAX_BACKLOG  (HRC_FIFO_DEPTH * 64)
+
+typedef struct {
+	bool used;
+	HRC_SIM_CONFIG cfg;
+	pthread_mutex_t lock;
+
+	uint8_t regs[256];
+	uint8_t fifo[HRC_FIFO_DEPTH][4];
+	uint8_t fifo_count;    // samples held, 16 is full (pointers alone cannot tell)
+	uint8_t fifo_byte;     // byte offset in the sample at the read pointer
+
+	uint64_t start_ns;     // CLOCK_MONOTONIC at open
+	uint64_t t0_ns;        // model time the current sampling run started
+	uint64_t produced;     // samples generated since t0_ns
+	uint64_t temp_done_ns; // model time the running conversion ends, 0 when idle
+
+	double phase;          // cardiac cycle phase [0,1)
+	double resp_phase;     // respiration cycle phase [0,1)
+	uint32_t rng;
+} HRC_SIM;
+
+static HRC_SIM hrc_sim[HRC_SIM_MAX_SENSORS];
+
+static const uint16_t hrc_sim_rates[8] = { 50, 100, 167, 200, 400, 600, 800, 1000 };
+
+static uint64_t HRC_SimMonotonicNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t HRC_SimNow(HRC_SIM *sim) {
+	return (uint64_t) ((double) (HRC_SimMonotonicNs() - sim->start_ns) * sim->cfg.speed);
+}
+
+static HRC_SIM *HRC_SimGet(int file) {
+	if (file < 0 || file >= HRC_SIM_MAX_SENSORS || !hrc_sim[file].used)
+		return NULL;
+	return &hrc_sim[file];
+}
+
+static uint16_t HRC_SimRate(HRC_SIM *sim) {
+	return hrc_sim_rates[(sim->regs[HRC_SPO2_CONFIG] & HRC_SAMPLES_MASK) >> 2];
+}
+
+// xorshift32, roughly gaussian by summing four draws
+static double HRC_SimNoise(HRC_SIM *sim) {
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		sim->rng ^= sim->rng << 13;
+		sim->rng ^= sim->rng >> 17;
+		sim->rng ^= sim->rng << 5;
+		sum += (double) sim->rng / 4294967295.0 - 0.5;
+	}
+	return sum;
+}
+
+// Pulse shape over one cardiac cycle: systolic peak plus dicrotic wave, in [0,1]
+static double HRC_SimPulse(double phase) {
+	double s = (phase - 0.18) / 0.07;
+	double d = (phase - 0.45) / 0.10;
+
+	return exp(-s * s) + 0.35 * exp(-d * d);
+}
+
+static uint16_t HRC_SimClamp(double value, double full_scale) {
+	if (value < 0)
+		return 0;
+	if (value > full_scale)
+		return (uint16_t) full_scale;
+	return (uint16_t) value;
+}
+
+// Next sample of the model at the configured rate, resolution and LED currents
+static void HRC_SimSample(HRC_SIM *sim, uint16_t *ir_out, uint16_t *red_out) {
+	uint8_t mode = sim->regs[HRC_MODE_CONFIG] & 0x07;
+	uint8_t spo2 = sim->regs[HRC_SPO2_CONFIG];
+	uint8_t led = sim->regs[HRC_LED_CONFIG];
+	double full_scale = (double) ((1 << (13 + (spo2 & HRC_PULSE_WIDTH_MASK))) - 1);
+	double ratio = (110.0 - sim->cfg.spo2) / 25.0;
+	double ir_dc, red_dc, pulse, resp;
+	uint16_t ir, red;
+
+	// absorption rises in systole, so the received light dips with the pulse
+	pulse = HRC_SimPulse(sim->phase) - 0.3;
+	resp = 0.15 * sin(2 * M_PI * sim->resp_phase);
+
+	ir_dc = full_scale * fmin(0.25 + 0.04 * (led & HRC_IR_CURRENT_MASK), 0.9);
+	red_dc = full_scale * fmin(0.20 + 0.04 * ((led & HRC_RED_CURRENT_MASK) >> 4), 0.9);
+
+	ir = HRC_SimClamp(ir_dc * (1.0 - HRC_SIM_PERFUSION * (pulse + resp + sim->cfg.noise * HRC_SimNoise(sim))), full_scale);
+	red = HRC_SimClamp(red_dc * (1.0 - ratio * HRC_SIM_PERFUSION * (pulse + resp + sim->cfg.noise * HRC_SimNoise(sim))), full_scale);
+	if (mode == HRC_HR_ONLY)
+		red = 0;
+
+	sim->phase += sim->cfg.heart_rate / 60.0 / HRC_SimRate(sim);
+	sim->phase -= floor(sim->phase);
+	sim->resp_phase += 0.25 / HRC_SimRate(sim);
+	sim->resp_phase -= floor(sim->resp_phase);
+
+	*ir_out = ir;
+	*red_out = red;
+}
+
+static void HRC_SimProduce(HRC_SIM *sim) {
+	uint8_t mode = sim->regs[HRC_MODE_CONFIG] & 0x07;
+	uint16_t ir, red;
+	uint8_t wr;
+
+	HRC_SimSample(sim, &ir, &red);
+
+	sim->regs[HRC_INT_STATUS] |= (mode == HRC_SPO2_EN) ? HRC_ENA_SO2_RDY : HRC_ENA_HR_RDY;
+
+	if (sim->fifo_count == HRC_FIFO_DEPTH) {
+		if (sim->regs[HRC_OVER_FLOW_CNT] < 0x0F)
+			sim->regs[HRC_OVER_FLOW_CNT]++;
+		return;
+	}
+
+	wr = sim->regs[HRC_FIFO_WRITE_PTR];
+	sim->fifo[wr][0] = ir >> 8;
+	sim->fifo[wr][1] = ir & 0xFF;
+	sim->fifo[wr][2] = red >> 8;
+	sim->fifo[wr][3] = red & 0xFF;
+	sim->regs[HRC_FIFO_WRITE_PTR] = (wr + 1) & (HRC_FIFO_DEPTH - 1);
+	sim->fifo_count++;
+
+	if (sim->fifo_count == HRC_FIFO_DEPTH - 1)
+		sim->regs[HRC_INT_STATUS] |= HRC_ENA_A_FULL;
+}
+
+// Bring the model up to the current time
+static void HRC_SimAdvance(HRC_SIM *sim) {
+	uint8_t mode = sim->regs[HRC_MODE_CONFIG];
+	uint64_t now = HRC_SimNow(sim);
+	uint64_t target;
+
+	if (sim->temp_done_ns && now >= sim->temp_done_ns) {
+		double t = sim->cfg.temperature;
+		int8_t integer = (int8_t) floor(t);
+
+		sim->regs[HRC_TEMP_INTEGER] = (uint8_t) integer;
+		sim->regs[HRC_TEMP_FRACTION] = (uint8_t) ((t - integer) / 0.0625) & 0x0F;
+		sim->regs[HRC_MODE_CONFIG] &= ~HRC_TEMP_EN;
+		sim->regs[HRC_INT_STATUS] |= HRC_ENA_TEP_RDY;
+		sim->temp_done_ns = 0;
+	}
+
+	// only HR and SpO2 modes sample, SHDN stops everything
+	if ((mode & HRC_SHDN) || ((mode & 0x07) != HRC_HR_ONLY && (mode & 0x07) != HRC_SPO2_EN)) {
+		sim->t0_ns = now;
+		sim->produced = 0;
+		return;
+	}
+
+	target = (now - sim->t0_ns) * HRC_SimRate(sim) / 1000000000ULL;
+
+	// after a long stall only the last samples matter, the rest overflowed anyway
+	if (target - sim->produced > HRC_SIM_MAX_BACKLOG) {
+		sim->regs[HRC_OVER_FLOW_CNT] = 0x0F;
+		sim->produced = target - HRC_SIM_MAX_BACKLOG;
+	}
+
+	while (sim->produced < target) {
+		HRC_SimProduce(sim);
+		sim->produced++;
+	}
+}
+
+static void HRC_SimRestart(HRC_SIM *sim) {
+	sim->t0_ns = HRC_SimNow(sim);
+	sim->produced = 0;
+}
+
+static void HRC_SimReset(HRC_SIM *sim) {
+	memset(sim->regs, 0, sizeof(sim->regs));
+	sim->regs[HRC_INT_STATUS] = HRC_PWR_RDY;
+	sim->regs[HRC_REVISION_ID] = HRC_SIM_REVISION_ID;
+	sim->regs[HRC_PART_ID] = HRC_SIM_PART_ID;
+	sim->fifo_count = 0;
+	sim->fifo_byte = 0;
+	sim->temp_done_ns = 0;
+	HRC_SimRestart(sim);
+}
+
+static uint8_t HRC_SimReadRegister(HRC_SIM *sim, uint8_t reg) {
+	uint8_t value;
+	uint8_t rd;
+
+	switch (reg) {
+	case HRC_INT_STATUS:
+		// status bits clear on read
+		value = sim->regs[HRC_INT_STATUS];
+		sim->regs[HRC_INT_STATUS] = 0;
+		return value;
+
+	case HRC_FIFO_DATA_REG:
+		if (sim->fifo_count == 0)
+			return 0;
+		rd = sim->regs[HRC_FIFO_READ_PTR];
+		value = sim->fifo[rd][sim->fifo_byte++];
+		if (sim->fifo_byte == 4) {
+			sim->fifo_byte = 0;
+			sim->regs[HRC_FIFO_READ_PTR] = (rd + 1) & (HRC_FIFO_DEPTH - 1);
+			sim->regs[HRC_OVER_FLOW_CNT] = 0;  // popping a sample clears the counter
+			sim->fifo_count--;
+		}
+		return value;
+
+	default:
+		return sim->regs[reg];
+	}
+}
+
+static void HRC_SimWriteRegister(HRC_SIM *sim, uint8_t reg, uint8_t data) {
+	switch (reg) {
+	case HRC_MODE_CONFIG:
+		if (data & HRC_RESET) {
+			HRC_SimReset(sim);
+			return;
+		}
+		if ((data & HRC_TEMP_EN) && sim->temp_done_ns == 0)
+			sim->temp_done_ns = HRC_SimNow(sim) + HRC_SIM_TEMP_CONV_NS;
+		if ((data ^ sim->regs[reg]) & 0x87)
+			HRC_SimRestart(sim);
+		sim->regs[reg] = data;
+		return;
+
+	case HRC_SPO2_CONFIG:
+		if ((data ^ sim->regs[reg]) & HRC_SAMPLES_MASK)
+			HRC_SimRestart(sim);
+		sim->regs[reg] = data;
+		return;
+
+	case HRC_FIFO_WRITE_PTR:
+	case HRC_FIFO_READ_PTR:
+		sim->regs[reg] = data & (HRC_FIFO_DEPTH - 1);
+		sim->fifo_count = (sim->regs[HRC_FIFO_WRITE_PTR] - sim->regs[HRC_FIFO_READ_PTR]) & (HRC_FIFO_DEPTH - 1);
+		sim->fifo_byte = 0;
+		return;
+
+	case HRC_OVER_FLOW_CNT:
+		sim->regs[reg] = data & 0x0F;
+		return;
+
+	case HRC_INT_STATUS:
+	case HRC_FIFO_DATA_REG:
+	case HRC_TEMP_INTEGER:
+	case HRC_TEMP_FRACTION:
+	case HRC_REVISION_ID:
+	case HRC_PART_ID:
+		// read only
+		return;
+
+	default:
+		sim->regs[reg] = data;
+		return;
+	}
+}
+
+static int HRC_SimReadByte(int file, uint8_t slave_register) {
+	HRC_SIM *sim = HRC_SimGet(file);
+	uint8_t value;
+
+	if (sim == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sim->lock);
+	HRC_SimAdvance(sim);
+	value = HRC_SimReadRegister(sim, slave_register);
+	pthread_mutex_unlock(&sim->lock);
+
+	return value;
+}
+
+static int HRC_SimWriteByte(int file, uint8_t slave_register, uint8_t data) {
+	HRC_SIM *sim = HRC_SimGet(file);
+
+	if (sim == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sim->lock);
+	HRC_SimAdvance(sim);
+	HRC_SimWriteRegister(sim, slave_register, data);
+	pthread_mutex_unlock(&sim->lock);
+
+	return 0;
+}
+
+static int HRC_SimWriteRegs(int file, const uint8_t (*pairs)[2], uint8_t n) {
+	HRC_SIM *sim = HRC_SimGet(file);
+	uint8_t i;
+
+	if (sim == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sim->lock);
+	HRC_SimAdvance(sim);
+	for (i = 0; i < n; i++)
+		HRC_SimWriteRegister(sim, pairs[i][0], pairs[i][1]);
+	pthread_mutex_unlock(&sim->lock);
+
+	return 0;
+}
+
+static int HRC_SimReadBurst(int file, uint8_t slave_register, uint8_t *block, uint16_t N) {
+	HRC_SIM *sim = HRC_SimGet(file);
+	uint8_t reg = slave_register;
+	uint16_t i;
+
+	if (sim == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sim->lock);
+	HRC_SimAdvance(sim);
+	for (i = 0; i < N; i++) {
+		block[i] = HRC_SimReadRegister(sim, reg);
+		// the register pointer auto-increments, except on the FIFO data register
+		if (reg != HRC_FIFO_DATA_REG)
+			reg++;
+	}
+	pthread_mutex_unlock(&sim->lock);
+
+	return 0;
+}
+
+static int HRC_SimReadBlock(int file, uint8_t slave_register, uint8_t *block, uint8_t N) {
+	return HRC_SimReadBurst(file, slave_register, block, N);
+}
+
+const HRC_TRANSPORT HRC_TransportSim = {
+	.name = "sim",
+	.read_byte = HRC_SimReadByte,
+	.write_byte = HRC_SimWriteByte,
+	.read_block = HRC_SimReadBlock,
+	.read_burst = HRC_SimReadBurst,
+	.write_regs = HRC_SimWriteRegs,
+	.close = HRC_SimClose,
+};
+
+int HRC_SimParseConfig(HRC_SIM_CONFIG *cfg, const char *spec) {
+	char key[16];
+	double value;
+	int consumed;
+
+	while (spec != NULL && *spec) {
+		if (sscanf(spec, " %15[^=,]=%lf%n", key, &value, &consumed) != 2) {
+			printf("HRC sim: cannot parse '%s'\n", spec);
+			return -1;
+		}
+
+		if (strcmp(key, "hr") == 0)
+			cfg->heart_rate = value;
+		else if (strcmp(key, "noise") == 0)
+			cfg->noise = value;
+		else if (strcmp(key, "spo2") == 0)
+			cfg->spo2 = value;
+		else if (strcmp(key, "temp") == 0)
+			cfg->temperature = value;
+		else if (strcmp(key, "speed") == 0 && value > 0)
+			cfg->speed = value;
+		else if (strcmp(key, "seed") == 0)
+			cfg->seed = (uint32_t) value;
+		else {
+			printf("HRC sim: unknown setting '%s'\n", key);
+			return -1;
+		}
+
+		spec += consumed;
+		if (*spec == ',')
+			spec++;
+	}
+
+	return 0;
+}
+
+int HRC_SimOpen(const HRC_SIM_CONFIG *cfg) {
+	int file;
+
+	for (file = 0; file < HRC_SIM_MAX_SENSORS; file++) {
+		HRC_SIM *sim = &hrc_sim[file];
+
+		if (sim->used)
+			continue;
+
+		memset(sim, 0, sizeof(*sim));
+		sim->used = true;
+		sim->cfg = *cfg;
+		sim->rng = cfg->seed ? cfg->seed : 1;
+		sim->start_ns = HRC_SimMonotonicNs();
+		pthread_mutex_init(&sim->lock, NULL);
+		HRC_SimReset(sim);
+		return file;
+	}
+
+	return -1;
+}
+
+void HRC_SimClose(int file) {
+	HRC_SIM *sim = HRC_SimGet(file);
+
+	if (sim == NULL)
+		return;
+
+	pthread_mutex_destroy(&sim->lock);
+	sim->used = false;
+}
+
+void HRC_SimSetHeartRate(int file, double bpm) {
+	HRC_SIM *sim = HRC_SimGet(file);
+
+	if (sim == NULL)
+		return;
+
+	pthread_mutex_lock(&sim->lock);
+	HRC_SimAdvance(sim);
+	sim->cfg.heart_rate = bpm;
+	pthread_mutex_unlock(&sim->lock);
+}
+
+int HRC_SimWaveform(int file, uint16_t *ir, uint16_t *red, uint32_t count) {
+	HRC_SIM *sim = HRC_SimGet(file);
+	uint32_t ix;
+
+	if (sim == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sim->lock);
+	for (ix = 0; ix < count; ix++)
+		HRC_SimSample(sim, &ir[ix], &red[ix]);
+	pthread_mutex_unlock(&sim->lock);
+
+	return 0;
+}
+
+uint32_t HRC_SimAFullPeriodUs(int file, uint16_t rate) {
+	HRC_SIM *sim = HRC_SimGet(file);
+
+	if (sim == NULL || rate == 0)
+		return 0;
+
+	return (uint32_t) ((HRC_FIFO_DEPTH - 1) * 1000000.0 / rate / sim->cfg.speed);
+}
@@ -0,0 +1,60 @@
+/* 
+ ** Simulated HRC sensor (register level model)
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_SIM__
+#define __HRC_SIM__
+
+#include <stdint.h>
+#include "HRC_transport.h"
+
+#define HRC_SIM_MAX_SENSORS  8
+#define HRC_SIM_PART_ID      0x11
+#define HRC_SIM_REVISION_ID  0x05
+
+typedef struct {
+	double heart_rate;  // [beats per minute]
+	double noise;       // noise amplitude relative to the pulse amplitude
+	double spo2;        // saturation the red/IR ratio is derived from [%]
+	double temperature; // die temperature [C]
+	double speed;       // model time scale, 1.0 = real time
+	uint32_t seed;
+} HRC_SIM_CONFIG;
+
+#define HRC_SIM_CONFIG_DEFAULT { 72.0, 0.02, 97.0, 31.5, 1.0, 1 }
+
+// spec - comma separated overrides, e.g. "hr=90,noise=0.1,spo2=95,temp=33,speed=4,seed=7"
+int HRC_SimParseConfig(HRC_SIM_CONFIG *cfg, const char *spec);
+
+// Returns the handle to pass as `file` with HRC_TransportSim, or -1
+int HRC_SimOpen(const HRC_SIM_CONFIG *cfg);
+void HRC_SimClose(int file);
+
+void HRC_SimSetHeartRate(int file, double bpm);
+
+// Generates count samples of the model at the sensor's configuration straight
+// into ir and red, past the FIFO and without waiting for model time; for
+// benchmarks. Returns 0, or -1 for an unknown file.
+int HRC_SimWaveform(int file, uint16_t *ir, uint16_t *red, uint32_t count);
+
+// Wall clock time between two A_FULL interrupts at `rate` samples per second
+uint32_t HRC_SimAFullPeriodUs(int file, uint16_t rate);
+
+#endif
@@ -0,0 +1,133 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "HRC_spo2.h"
+#include "HRC_hr.h"
+
+#define HRC_SPO2_MIN_SAMPLES 8    // shortest window worth evaluating
+#define HRC_SPO2_MIN_PERMILLE 1   // smallest IR pulse amplitude relative to DC [1/1000]
+#define HRC_SPO2_LUT_SIZE    (1 << (HRC_SPO2_RATIO_SHIFT + 1))
+
+// Table entries are constant expressions, the compiler evaluates the curve,
+// so there is no floating point left at run time.
+#define HRC_SPO2_R(i)        ((double) (i) / (1 << HRC_SPO2_RATIO_SHIFT))
+#define HRC_SPO2_CURVE(i)    (10.0 * (HRC_SPO2_CAL_A * HRC_SPO2_R(i) * HRC_SPO2_R(i) + \
+                              HRC_SPO2_CAL_B * HRC_SPO2_R(i) + HRC_SPO2_CAL_C))
+#define HRC_SPO2_ENTRY(i)    ((uint16_t) (HRC_SPO2_CURVE(i) > 1000.0 ? 1000.0 : \
+                              HRC_SPO2_CURVE(i) < 0.0 ? 0.0 : HRC_SPO2_CURVE(i) + 0.5))
+
+#define HRC_SPO2_E4(i)       HRC_SPO2_ENTRY(i), HRC_SPO2_ENTRY((i) + 1), HRC_SPO2_ENTRY((i) + 2), HRC_SPO2_ENTRY((i) + 3)
+#define HRC_SPO2_E16(i)      HRC_SPO2_E4(i), HRC_SPO2_E4((i) + 4), HRC_SPO2_E4((i) + 8), HRC_SPO2_E4((i) + 12)
+#define HRC_SPO2_E64(i)      HRC_SPO2_E16(i), HRC_SPO2_E16((i) + 16), HRC_SPO2_E16((i) + 32), HRC_SPO2_E16((i) + 48)
+#define HRC_SPO2_E256(i)     HRC_SPO2_E64(i), HRC_SPO2_E64((i) + 64), HRC_SPO2_E64((i) + 128), HRC_SPO2_E64((i) + 192)
+
+// SpO2 in tenths of a percent, indexed by R in Q1.7
+static const uint16_t hrc_spo2_lut[HRC_SPO2_LUT_SIZE] = { HRC_SPO2_E256(0) };
+
+_Static_assert(HRC_SPO2_LUT_SIZE == 256, "HRC_SPO2_E256 fills exactly 256 entries");
+
+static void HRC_Spo2Restart(HRC_SPO2 *spo2) {
+	spo2->n = 0;
+	spo2->red_sum = 0;
+	spo2->ir_sum = 0;
+	spo2->red_min = UINT16_MAX;
+	spo2->red_max = 0;
+	spo2->ir_min = UINT16_MAX;
+	spo2->ir_max = 0;
+}
+
+void HRC_Spo2Init(HRC_SPO2 *spo2, uint16_t sample_rate) {
+	memset(spo2, 0, sizeof(*spo2));
+	HRC_Spo2SetRate(spo2, sample_rate);
+	HRC_Spo2Restart(spo2);
+}
+
+void HRC_Spo2SetRate(HRC_SPO2 *spo2, uint16_t sample_rate) {
+	// a beat at HRC_HR_MIN_BPM, no window is longer
+	spo2->max_n = (uint32_t) sample_rate * 60 / HRC_HR_MIN_BPM;
+}
+
+void HRC_Spo2Update(HRC_SPO2 *spo2, uint16_t red, uint16_t ir) {
+	// no beat for longer than any beat lasts, e.g. the finger is off
+	if (spo2->n >= spo2->max_n)
+		HRC_Spo2Restart(spo2);
+
+	spo2->n++;
+	spo2->red_sum += red;
+	spo2->ir_sum += ir;
+	if (red < spo2->red_min)
+		spo2->red_min = red;
+	if (red > spo2->red_max)
+		spo2->red_max = red;
+	if (ir < spo2->ir_min)
+		spo2->ir_min = ir;
+	if (ir > spo2->ir_max)
+		spo2->ir_max = ir;
+}
+
+bool HRC_Spo2Beat(HRC_SPO2 *spo2) {
+	uint64_t red_ac, ir_ac, red_dc, ir_dc, num, den;
+	uint32_t ratio;
+	uint16_t value;
+
+	if (spo2->n < HRC_SPO2_MIN_SAMPLES)
+		goto reject;
+
+	red_ac = spo2->red_max - spo2->red_min;
+	ir_ac = spo2->ir_max - spo2->ir_min;
+	red_dc = spo2->red_sum / spo2->n;
+	ir_dc = spo2->ir_sum / spo2->n;
+
+	// no red channel (HR only mode) or no usable pulse
+	if (red_dc == 0 || ir_dc == 0 || red_ac == 0 || ir_ac * 1000 < ir_dc * HRC_SPO2_MIN_PERMILLE)
+		goto reject;
+
+	// R = (red_ac / red_dc) / (ir_ac / ir_dc), in Q1.7
+	num = (red_ac * ir_dc) << HRC_SPO2_RATIO_SHIFT;
+	den = red_dc * ir_ac;
+	ratio = (uint32_t) ((num + den / 2) / den);
+	if (ratio >= HRC_SPO2_LUT_SIZE)
+		goto reject;
+
+	value = hrc_spo2_lut[ratio];
+
+	if (spo2->result.windows == HRC_SPO2_WINDOWS)
+		spo2->sum -= spo2->history[spo2->next];
+	else
+		spo2->result.windows++;
+	spo2->history[spo2->next] = value;
+	spo2->sum += value;
+	spo2->next = (spo2->next + 1) & (HRC_SPO2_WINDOWS - 1);
+
+	spo2->result.spo2 = (spo2->sum + spo2->result.windows / 2) / spo2->result.windows;
+	spo2->result.accepted++;
+	HRC_Spo2Restart(spo2);
+	return true;
+
+reject:
+	spo2->result.rejected++;
+	HRC_Spo2Restart(spo2);
+	return false;
+}
+
+void HRC_Spo2GetResult(const HRC_SPO2 *spo2, HRC_SPO2_RESULT *result) {
+	*result = spo2->result;
+}
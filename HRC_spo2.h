@@ -0,0 +1,76 @@
+/* 
+ ** SpO2 estimation (ratio of ratios)
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_SPO2__
+#define __HRC_SPO2__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Calibration curve SpO2 = A*R^2 + B*R + C [%], R = (ACred/DCred) / (ACir/DCir).
+// Only used to build the lookup table at compile time.
+#ifndef HRC_SPO2_CAL_A
+#define HRC_SPO2_CAL_A       0.0
+#define HRC_SPO2_CAL_B       (-25.0)
+#define HRC_SPO2_CAL_C       110.0
+#endif
+
+#define HRC_SPO2_RATIO_SHIFT 7    // R is looked up in Q1.7, i.e. R < 2.0
+#define HRC_SPO2_WINDOWS     4    // beat windows averaged, power of two
+
+typedef struct {
+	uint16_t spo2;       // tenths of a percent, 0 until a window was accepted
+	uint8_t windows;     // windows in the current average
+	uint32_t accepted;   // windows accepted since init
+	uint32_t rejected;   // windows rejected since init
+} HRC_SPO2_RESULT;
+
+typedef struct {
+	// current beat window, restarted past the longest beat interval when
+	// no beat closes it, so the 32-bit sums cannot wrap
+	uint32_t n;
+	uint32_t max_n;
+	uint32_t red_sum, ir_sum;
+	uint16_t red_min, red_max;
+	uint16_t ir_min, ir_max;
+
+	// average over the last HRC_SPO2_WINDOWS accepted windows
+	uint16_t history[HRC_SPO2_WINDOWS];
+	uint8_t next;
+	uint32_t sum;
+
+	HRC_SPO2_RESULT result;
+} HRC_SPO2;
+
+void HRC_Spo2Init(HRC_SPO2 *spo2, uint16_t sample_rate);
+// Follows a change of the input rate, the windows and the average carry on
+void HRC_Spo2SetRate(HRC_SPO2 *spo2, uint16_t sample_rate);
+
+// Adds one red/IR sample to the current beat window
+void HRC_Spo2Update(HRC_SPO2 *spo2, uint16_t red, uint16_t ir);
+
+// Closes the current window at a beat and folds it into the estimate.
+// Returns true when the window was accepted.
+bool HRC_Spo2Beat(HRC_SPO2 *spo2);
+
+void HRC_Spo2GetResult(const HRC_SPO2 *spo2, HRC_SPO2_RESULT *result);
+
+#endif
@@ -0,0 +1,180 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "HRC_stats.h"
+
+static const char *hrc_stage_names[HRC_STAGE_COUNT] = {
+	"i2c", "drain", "dsp", "encode", "queue", "dowork", "ack",
+};
+
+const char *HRC_StatsStageName(HRC_STAGE stage) {
+	return stage < HRC_STAGE_COUNT ? hrc_stage_names[stage] : "?";
+}
+
+// lowest value counted in bucket ix
+static uint32_t HRC_StatsBucketLow(uint32_t ix) {
+	if (ix < HRC_STATS_SUB_BUCKETS)
+		return ix;
+	return (HRC_STATS_SUB_BUCKETS + ix % HRC_STATS_SUB_BUCKETS) << (ix / HRC_STATS_SUB_BUCKETS - 1);
+}
+
+uint32_t HRC_StatsPercentile(const HRC_STAGE_STATS *stats, uint32_t permille) {
+	uint64_t rank, seen;
+	uint32_t ix, high;
+
+	if (stats->count == 0)
+		return 0;
+
+	rank = ((uint64_t) stats->count * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	seen = 0;
+	for (ix = 0; ix < HRC_STATS_BUCKETS - 1; ix++) {
+		seen += stats->bucket[ix];
+		if (seen >= rank)
+			break;
+	}
+
+	high = ix < HRC_STATS_BUCKETS - 1 ? HRC_StatsBucketLow(ix + 1) - 1 : stats->max_us;
+	return high < stats->max_us ? high : stats->max_us;
+}
+
+#ifdef HRC_STATS
+
+// the acquisition thread records too; 32 bit so armv5 needs no libatomic
+static struct {
+	atomic_uint count;
+	atomic_uint total_us;
+	atomic_uint max_us;
+	atomic_uint bucket[HRC_STATS_BUCKETS];
+} hrc_stages[HRC_STAGE_COUNT];
+
+uint32_t HRC_StatsNowUs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ts.tv_sec * 1000000U + ts.tv_nsec / 1000;
+}
+
+static uint32_t HRC_StatsBucket(uint32_t us) {
+	uint32_t log2;
+
+	if (us < HRC_STATS_SUB_BUCKETS)
+		return us;
+
+	log2 = 31 - __builtin_clz(us);
+	if (log2 >= HRC_STATS_MAX_LOG2)
+		return HRC_STATS_BUCKETS - 1;
+
+	// the two bits below the leading one pick the quarter of the octave
+	return (log2 - 1) * HRC_STATS_SUB_BUCKETS + ((us >> (log2 - 2)) & (HRC_STATS_SUB_BUCKETS - 1));
+}
+
+void HRC_StatsRecord(HRC_STAGE stage, uint32_t us) {
+	unsigned int max;
+
+	if (stage >= HRC_STAGE_COUNT)
+		return;
+
+	atomic_fetch_add_explicit(&hrc_stages[stage].count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&hrc_stages[stage].total_us, us, memory_order_relaxed);
+	atomic_fetch_add_explicit(&hrc_stages[stage].bucket[HRC_StatsBucket(us)], 1, memory_order_relaxed);
+
+	max = atomic_load_explicit(&hrc_stages[stage].max_us, memory_order_relaxed);
+	while (us > max && !atomic_compare_exchange_weak_explicit(&hrc_stages[stage].max_us, &max, us,
+				memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+bool HRC_StatsGet(HRC_STAGE stage, HRC_STAGE_STATS *stats) {
+	uint32_t ix;
+
+	memset(stats, 0, sizeof(*stats));
+	if (stage >= HRC_STAGE_COUNT)
+		return false;
+
+	// not one atomic snapshot: a sample recorded meanwhile may show in some fields only
+	stats->count = atomic_load_explicit(&hrc_stages[stage].count, memory_order_relaxed);
+	stats->total_us = atomic_load_explicit(&hrc_stages[stage].total_us, memory_order_relaxed);
+	stats->max_us = atomic_load_explicit(&hrc_stages[stage].max_us, memory_order_relaxed);
+	for (ix = 0; ix < HRC_STATS_BUCKETS; ix++)
+		stats->bucket[ix] = atomic_load_explicit(&hrc_stages[stage].bucket[ix], memory_order_relaxed);
+
+	return true;
+}
+
+int HRC_StatsWrite(const char *path) {
+	char tmp[256];
+	HRC_STAGE_STATS stats;
+	uint32_t stage;
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int) sizeof(tmp)) {
+		printf("HRC stats: path too long '%s'\n", path);
+		return -1;
+	}
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		printf("HRC stats: cannot create '%s': %s\n", tmp, strerror(errno));
+		return -1;
+	}
+
+	dprintf(fd, "# %-8s %10s %12s %8s %8s %8s %8s %8s (us)\n",
+			"stage", "count", "total", "mean", "p50", "p90", "p99", "max");
+	for (stage = 0; stage < HRC_STAGE_COUNT; stage++) {
+		HRC_StatsGet(stage, &stats);
+		dprintf(fd, "%-10s %10u %12u %8u %8u %8u %8u %8u\n",
+				HRC_StatsStageName(stage), stats.count, stats.total_us,
+				stats.count ? stats.total_us / stats.count : 0,
+				HRC_StatsPercentile(&stats, 500), HRC_StatsPercentile(&stats, 900),
+				HRC_StatsPercentile(&stats, 990), stats.max_us);
+	}
+
+	if (close(fd) < 0 || rename(tmp, path) < 0) {
+		printf("HRC stats: cannot write '%s': %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+#else
+
+bool HRC_StatsGet(HRC_STAGE stage, HRC_STAGE_STATS *stats) {
+	memset(stats, 0, sizeof(*stats));
+	return false;
+}
+
+int HRC_StatsWrite(const char *path) {
+	return -1;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ ** Per stage latency histograms of the sample to cloud path
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_STATS__
+#define __HRC_STATS__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Built with HRC_STATS (make STATS=1). Without it the HRC_STATS_* macros
+// expand to nothing, no clock is read and no counter is touched.
+
+typedef enum {
+	HRC_STAGE_I2C,      // one bus transaction (ioctl)
+	HRC_STAGE_DRAIN,    // FIFO drain: status burst, data burst, unpack, ring push
+	HRC_STAGE_DSP,      // HRC_Process: HR, SpO2 and waveform codec
+	HRC_STAGE_ENCODE,   // one telemetry record serialized into its message body
+	HRC_STAGE_QUEUE,    // first record of a body until the body is sent or stored
+	HRC_STAGE_DOWORK,   // IoTHubDeviceClient_LL_DoWork
+	HRC_STAGE_ACK,      // message handed to the client until it is confirmed
+	HRC_STAGE_COUNT
+} HRC_STAGE;
+
+// Four buckets per power of two: 0..3 us one each, then [4,5), [5,6), ...
+// [2^k, 2^k * 5/4), ... so a percentile is known to within 25%.
+#define HRC_STATS_SUB_BUCKETS    4
+#define HRC_STATS_MAX_LOG2       27    // values from 2^27 us (134 s) on share the last bucket
+#define HRC_STATS_BUCKETS        ((HRC_STATS_MAX_LOG2 - 1) * HRC_STATS_SUB_BUCKETS)
+
+// Snapshot of one stage. Counters wrap at 2^32, total_us after 71 minutes
+// of accumulated time; differences of two snapshots stay right.
+typedef struct {
+	uint32_t count;
+	uint32_t total_us;
+	uint32_t max_us;
+	uint32_t bucket[HRC_STATS_BUCKETS];
+} HRC_STAGE_STATS;
+
+#ifdef HRC_STATS
+
+// CLOCK_MONOTONIC in us, wraps every 71 minutes
+uint32_t HRC_StatsNowUs(void);
+
+// Safe from any thread
+void HRC_StatsRecord(HRC_STAGE stage, uint32_t us);
+
+#define HRC_STATS_START(t)           uint32_t t = HRC_StatsNowUs()
+#define HRC_STATS_STOP(stage, t)     HRC_StatsRecord(stage, HRC_StatsNowUs() - (t))
+#define HRC_STATS_RECORD(stage, us)  HRC_StatsRecord(stage, us)
+
+#else
+
+#define HRC_STATS_START(t)
+#define HRC_STATS_STOP(stage, t)
+#define HRC_STATS_RECORD(stage, us)
+
+#endif
+
+// false when the program was built without the histograms
+bool HRC_StatsGet(HRC_STAGE stage, HRC_STAGE_STATS *stats);
+
+const char *HRC_StatsStageName(HRC_STAGE stage);
+
+// Smallest value v with at least permille/1000 of the samples <= v,
+// the upper end of the bucket it falls in capped by max_us; 0 without samples
+uint32_t HRC_StatsPercentile(const HRC_STAGE_STATS *stats, uint32_t permille);
+
+// Writes counters and percentiles of every stage to path through a temporary
+// file and rename(), so a reader never sees a partial table. Returns 0 or -1.
+int HRC_StatsWrite(const char *path);
+
+#endif
@@ -0,0 +1,156 @@
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "HRC_fixed.h"
+#include "HRC_text.h"
+
+// Two digits per division halves the divisions, which are library calls on the target
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+uint8_t HRC_UintToString(char *out, uint64_t value) {
+	char digits[20];
+	uint8_t n = sizeof(digits), len;
+	uint32_t low, pair;
+
+	// 64 bit division only above 2^32, the common case stays in 32 bit
+	while (value > UINT32_MAX) {
+		pair = (uint32_t) (value % 100) * 2;
+		value /= 100;
+		digits[--n] = digit_pairs[pair + 1];
+		digits[--n] = digit_pairs[pair];
+	}
+
+	low = (uint32_t) value;
+	while (low >= 100) {
+		pair = (low % 100) * 2;
+		low /= 100;
+		digits[--n] = digit_pairs[pair + 1];
+		digits[--n] = digit_pairs[pair];
+	}
+	if (low >= 10) {
+		digits[--n] = digit_pairs[low * 2 + 1];
+		digits[--n] = digit_pairs[low * 2];
+	} else {
+		digits[--n] = '0' + low;
+	}
+
+	len = sizeof(digits) - n;
+	memcpy(out, digits + n, len);
+	return len;
+}
+
+void HRC_TextInit(HRC_TEXT *text, char *buf, size_t size) {
+	text->buf = buf;
+	text->size = size;
+	text->length = 0;
+	text->overflow = size == 0;
+	if (size)
+		buf[0] = 0;
+}
+
+static void HRC_TextPut(HRC_TEXT *text, const char *s, size_t len) {
+	if (text->overflow || text->length + len >= text->size) {
+		text->overflow = true;
+		return;
+	}
+	memcpy(text->buf + text->length, s, len);
+	text->length += len;
+	text->buf[text->length] = 0;
+}
+
+void HRC_TextPutChar(HRC_TEXT *text, char c) {
+	HRC_TextPut(text, &c, 1);
+}
+
+void HRC_TextPutString(HRC_TEXT *text, const char *s) {
+	HRC_TextPut(text, s, strlen(s));
+}
+
+void HRC_TextPutUint(HRC_TEXT *text, uint64_t value) {
+	char digits[20];
+
+	HRC_TextPut(text, digits, HRC_UintToString(digits, value));
+}
+
+void HRC_TextPutInt(HRC_TEXT *text, int64_t value) {
+	char digits[21];
+	uint8_t len = 0;
+
+	if (value < 0)
+		digits[len++] = '-';
+	len += HRC_UintToString(digits + len, value < 0 ? -(uint64_t) value : (uint64_t) value);
+	HRC_TextPut(text, digits, len);
+}
+
+void HRC_TextPutDecimal(HRC_TEXT *text, int64_t value, uint8_t decimals) {
+	char digits[24];
+	uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+	uint8_t len = 0, n, point;
+
+	if (decimals > 19)
+		decimals = 19;
+
+	if (value < 0)
+		digits[len++] = '-';
+
+	// left pad with zeros so there is at least one digit before the point
+	n = HRC_UintToString(digits + len, magnitude);
+	if (n <= decimals) {
+		memmove(digits + len + decimals + 1 - n, digits + len, n);
+		memset(digits + len, '0', decimals + 1 - n);
+		n = decimals + 1;
+	}
+	len += n;
+
+	if (decimals) {
+		point = len - decimals;
+		memmove(digits + point + 1, digits + point, decimals);
+		digits[point] = '.';
+		len++;
+	}
+
+	HRC_TextPut(text, digits, len);
+}
+
+void HRC_TextPutQ16(HRC_TEXT *text, HRC_Q16 value, uint8_t decimals) {
+	static const uint32_t scale[5] = { 1, 10, 100, 1000, 10000 };
+	uint64_t magnitude;
+
+	if (decimals > 4)
+		decimals = 4;
+
+	// |value| * 10^decimals, rounded, in units of the last digit
+	magnitude = value < 0 ? (uint64_t) -(int64_t) value : (uint64_t) value;
+	magnitude = (magnitude * scale[decimals] + (HRC_Q16_ONE >> 1)) >> 16;
+
+	HRC_TextPutDecimal(text, value < 0 ? -(int64_t) magnitude : (int64_t) magnitude, decimals);
+}
@@ -0,0 +1,55 @@
+/* 
+ ** Allocation free text building and integer formatting
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_TEXT__
+#define __HRC_TEXT__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HRC_fixed.h"
+
+// Appends to a caller provided buffer, always NUL terminated. Output that
+// does not fit sets overflow and is dropped whole, never cut in the middle.
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t length;
+	bool overflow;
+} HRC_TEXT;
+
+void HRC_TextInit(HRC_TEXT *text, char *buf, size_t size);
+void HRC_TextPutChar(HRC_TEXT *text, char c);
+void HRC_TextPutString(HRC_TEXT *text, const char *s);
+void HRC_TextPutUint(HRC_TEXT *text, uint64_t value);
+void HRC_TextPutInt(HRC_TEXT *text, int64_t value);
+
+// value / 10^decimals with all decimals written, e.g. 3150, 2 -> "31.50"
+void HRC_TextPutDecimal(HRC_TEXT *text, int64_t value, uint8_t decimals);
+
+// Rounded to decimals (0..4) digits
+void HRC_TextPutQ16(HRC_TEXT *text, HRC_Q16 value, uint8_t decimals);
+
+// Digits of value into out (room for 20), returns their count; the building block of the above
+uint8_t HRC_UintToString(char *out, uint64_t value);
+
+#endif
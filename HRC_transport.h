@@ -0,0 +1,55 @@
+/* 
+ ** HRC register transport interface
+ */
+
+/*
+ * Copyright 2026 Microchip
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __HRC_TRANSPORT__
+#define __HRC_TRANSPORT__
+
+#include <stdint.h>
+
+// Register level access to one sensor. `file` is whatever handle the
+// backend handed out: an i2c-dev fd for the real bus, an instance
+// number for the simulated sensor.
+typedef struct {
+	const char *name;
+	// returns the register value, or -1 on error
+	int (*read_byte)(int file, uint8_t slave_register);
+	// returns 0, or -1 on error
+	int (*write_byte)(int file, uint8_t slave_register, uint8_t data);
+	// reads N bytes starting at slave_register, returns 0, or -1 on error
+	int (*read_block)(int file, uint8_t slave_register, uint8_t *block, uint8_t N);
+	// same as read_block without the 32 byte SMBus limit, as one bus transaction
+	int (*read_burst)(int file, uint8_t slave_register, uint8_t *buf, uint16_t len);
+	// writes n {register, value} pairs as one bus transaction, returns 0, or -1 on error
+	int (*write_regs)(int file, const uint8_t (*pairs)[2], uint8_t n);
+	// gives the handle back
+	void (*close)(int file);
+} HRC_TRANSPORT;
+
+extern const HRC_TRANSPORT HRC_TransportI2C;
+extern const HRC_TRANSPORT HRC_TransportSim;
+
+// Opens an i2c-dev bus and binds it to the sensor at slave_addr, returns the fd or -1 (errno set)
+int HRC_I2COpen(const char *path, uint8_t slave_addr);
+
+// i2c-dev transactions that failed since start, all threads
+uint32_t HRC_I2CErrors(void);
+
+#endif
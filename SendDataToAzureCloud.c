@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <signal.h>
 #include <err.h>
 #include <errno.h>
 #include <linux/types.h>
@@ -68,14 +69,34 @@
 
 // Headers that provide implementation for subcomponents (the two thermostat components and DeviceInfo)
 #include "Azure_component.h"
+#include "Azure_batch.h"
 //#include "iothub_deviceinfo_component.h"
 #include "HRC_driver.h"
+#include "HRC_irq.h"
+#include "HRC_sim.h"
+#include "HRC_transport.h"
+#include "HRC_bus.h"
+#include "HRC_acq.h"
+#include "HRC_dsp.h"
+#include "HRC_alloc.h"
+#include "HRC_stats.h"
+#include "HRC_metrics.h"
+#include "HRC_ring.h"
+#include "HRC_loop.h"
+#include "HRC_adapt.h"
 
-#define CURRENT_WORKING_SET_BUFFER_SIZE 64
-
-// Every time the main loop wakes up, on the g_sendTelemetryPollInterval(th) pass will send a telemetry message.
-// So we will send telemetry every (g_sendTelemetryPollInterval * g_sleepBetweenPollsMs) milliseconds; 30 seconds as currently configured.
-static const int g_sendTelemetryPollInterval = 400;
+// Default periods of the event loop timers.  IoTHubDeviceClient_LL_DoWork should run about every 100 milliseconds,
+// each telemetry stream is sampled on its own timer.
+static const uint32_t g_doWorkPeriodMs = 100;
+static const uint32_t g_metricsPeriodMs = 1000;
+static const uint32_t g_temperaturePeriodMs = 1000;
+static const uint32_t g_heartRatePeriodMs = 1000;
+// Period of HRC_Process while acquisition threads fill the sensor rings, well inside the time a ring takes to fill.
+static const uint32_t g_processPeriodMs = 100;
+// Period at which the stage latency table is rewritten.
+static const uint32_t g_statsPeriodMs = 5000;
+// Period at which the sample rate and pulse width of every sensor are reconsidered.
+static const uint32_t g_adaptPeriodMs = 1000;
 
 // Whether tracing at the IoT Hub client is enabled or not.
 static bool g_hubClientTraceEnabled = true;
@@ -83,10 +104,6 @@ static bool g_hubClientTraceEnabled = true;
 // DTMI indicating this device's model identifier.
 static const char g_temperatureControllerModelId[] = "dtmi:com:example:TemperatureController;1";
 
-// Metadata to add to telemetry messages.
-static const char g_jsonContentType[] = "application/json";
-static const char g_utf8EncodingType[] = "utf8";
-
 // HR_COMPONENT_HANDLE represent the thermostat components that are sub-components of the temperature controller.
 // Note that we do NOT have an analogous DeviceInfo component handle because there is only DeviceInfo subcomponent and its
 // implementation is straightforward.
@@ -95,16 +112,79 @@ HR_COMPONENT_HANDLE Handle1;
 // Name of subcomponents that TemmperatureController implements.
 static const char g_thermostatComponent1Name[] = "thermostat1";
 
-// Minimum value we will return for working set, + some random number.
-static const int g_workingSetMinimum = 1000;
-// Random number for working set will range between the g_workingSetMinimum and (g_workingSetMinimum+g_workingSetRandomModulo).
-static const int g_workingSetRandomModulo = 500;
-// Format string for sending a telemetry message with the working set.
-static const char g_workingSetTelemetryFormat[] = "{\"workingSet\":%d}";
+// Environment variable selecting the sensor INT sources: unset for polling, or per sensor and separated by commas "" for polling,
+// "sim", or "<gpiochip>:<line>", e.g. "gpiochip0:17,gpiochip0:27".  Sensors past the end of the list use its last entry.
+static const char g_hrcIntEnvironmentVariable[] = "HRC_INT_GPIO";
+
+// Bus path that selects a simulated sensor instead of i2c-dev, and the variable holding its settings (see HRC_SimParseConfig).
+// Each further simulated sensor uses the next seed.
+static const char g_hrcSimPath[] = "sim";
+static const char g_hrcSimEnvironmentVariable[] = "HRC_SIM";
+
+// Environment variable that moves sensor acquisition to its own thread, e.g. "prio=50,cpus=0x2,mlock=1" (see HRC_AcqParseConfig).
+static const char g_hrcAcqEnvironmentVariable[] = "HRC_ACQ";
+
+// Environment variable forcing the signal kernels, "scalar" or "neon"; unset picks the fastest the CPU supports.
+static const char g_hrcDspEnvironmentVariable[] = "HRC_DSP";
+
+// Environment variable with the telemetry batch limits, e.g. "count=16,bytes=1024,age=30000,window=8" (see TelemetryBatch_ParseConfig).
+static const char g_telemetryBatchEnvironmentVariable[] = "HRC_BATCH";
+
+// Environment variable choosing the telemetry encoding, "json", "cbor" or per stream "temperature=cbor,heartRate=json".
+static const char g_telemetryEncodingEnvironmentVariable[] = "HRC_ENCODING";
+
+// Environment variable that, when set to 1, uploads the raw IR/RED waveform (see HRC_codec.h).
+static const char g_hrcWaveformEnvironmentVariable[] = "HRC_WAVEFORM";
+
+// Environment variable that keeps telemetry on flash while the hub is unreachable, "" for the defaults or
+// e.g. "dir=/data/telemetry,size=1048576,evict=oldest,rate=5" (see TelemetryStore_ParseConfig).
+static const char g_telemetryStoreEnvironmentVariable[] = "HRC_STORE";
+
+// Environment variable overriding the event loop periods in ms, e.g. "dowork=100,temperature=5000,drain=20" (see HRC_LoopParseConfig).
+static const char g_hrcLoopEnvironmentVariable[] = "HRC_LOOP";
+
+// Environment variable naming the file that receives the stage latency table, when built with STATS=1 (see HRC_stats.h).
+static const char g_hrcStatsEnvironmentVariable[] = "HRC_STATS_FILE";
+
+// Environment variable tuning how sample rate and pulse width follow signal quality and load, "off" keeps the rate
+// HRC_Startup set, e.g. "min=50,rest=100,max=400,hold=10000,settle=30000,cpu=700" (see HRC_AdaptParseConfig).
+static const char g_hrcAdaptEnvironmentVariable[] = "HRC_ADAPT";
 
 // Values of connection / security settings read from environment variables and/or DPS runtime.
 DEVICE_CONFIGURATION g_DeviceConfiguration;
 
+// State the event loop handlers work on.
+typedef struct
+{
+	IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient;
+	TELEMETRY_BATCH_HANDLE batchHandle;
+	TELEMETRY_STORE_HANDLE storeHandle;
+	const char* statsPath;
+} EVENT_LOOP_CONTEXT;
+
+// One sensor with the state its event loop handlers work on.
+typedef struct
+{
+	HRC_DEVICE device;
+	HR_WAVEFORM_CONTEXT waveform;
+	// Drain timer when there is no INT source, re-armed after every drain.
+	HRC_LOOP_SOURCE* drainSource;
+	// Picks the sample rate and pulse width on the adapt timer.
+	HRC_ADAPT adapt;
+} SENSOR;
+
+// Sensors named on the command line, in that order.
+static SENSOR g_sensors[HRC_MAX_DEVICES];
+static uint32_t g_sensorCount;
+
+// Schedules all periodic work and sensor interrupts of the application.
+static HRC_LOOP g_eventLoop;
+
+// Memory and CPU use of this process, sampled on the metrics timer.
+static HRC_METRICS g_processMetrics;
+// Latest sample of g_processMetrics, the CPU load the adapt timer goes by.
+static HRC_METRICS_SAMPLE g_lastMetrics;
+
 //
 // TempControlComponent_UpdatedPropertyCallback is invoked when properties arrive from the server.
 //
@@ -176,43 +256,401 @@ static void TempControlComponent_UpdatedPropertyCallback(
 }
 
 //
-// TempControlComponent_SendWorkingSet sends a telemetry indicating the current working set of the device, in 
+// SensorNumber returns the number telemetry of sensor carries, TELEMETRY_VALUE_ABSENT while there is only one sensor
+// so that its records look as they did before several were supported.
+//
+static int32_t SensorNumber(const SENSOR* sensor)
+{
+	return g_sensorCount > 1 ? (int32_t)(sensor - g_sensors) : TELEMETRY_VALUE_ABSENT;
+}
+
+//
+// TempControlComponent_SendWorkingSet queues a telemetry record indicating the current working set of the device, in 
 // the unit of kibibytes (https://en.wikipedia.org/wiki/Kibibyte).
 //
-void TempControlComponent_SendWorkingSet(IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient) 
+void TempControlComponent_SendWorkingSet(TELEMETRY_BATCH_HANDLE batchHandle, const HRC_METRICS_SAMPLE* sample) 
 {
-	IOTHUB_MESSAGE_HANDLE messageHandle = NULL;
-	IOTHUB_MESSAGE_RESULT messageResult;
-	IOTHUB_CLIENT_RESULT iothubClientResult;
-	char workingSetTelemetryPayload[CURRENT_WORKING_SET_BUFFER_SIZE];
+	int32_t workingSet = (int32_t)sample->rss_kib;
+
+	// Queue it for the next telemetry message.
+	(void)TelemetryBatch_Add(batchHandle, TELEMETRY_STREAM_WORKING_SET, &workingSet);
+}
+
+//
+// SendProcessMetrics queues a telemetry record with the CPU use, the scheduling and bus error counters and the depth
+// of each queue between the sensors and the hub.
+//
+static void SendProcessMetrics(EVENT_LOOP_CONTEXT* loopContext, const HRC_METRICS_SAMPLE* sample)
+{
+	TELEMETRY_BATCH_STATS batchStats;
+	TELEMETRY_STORE_STATS storeStats = { 0 };
+	uint32_t ringDepth = 0;
+	uint32_t i;
+	int32_t values[8];
+
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		ringDepth += HRC_RingCount(&g_sensors[i].device.ring);
+	}
+
+	TelemetryBatch_GetStats(loopContext->batchHandle, &batchStats);
+	if (loopContext->storeHandle != NULL)
+	{
+		TelemetryStore_GetStats(loopContext->storeHandle, &storeStats);
+	}
+
+	values[0] = (int32_t)sample->cpu_permille;
+	values[1] = (int32_t)sample->voluntary_switches;
+	values[2] = (int32_t)sample->involuntary_switches;
+	values[3] = (int32_t)sample->major_faults;
+	values[4] = (int32_t)HRC_I2CErrors();
+	values[5] = (int32_t)ringDepth;
+	values[6] = (int32_t)batchStats.inFlight;
+	values[7] = (int32_t)storeStats.records;
+
+	(void)TelemetryBatch_Add(loopContext->batchHandle, TELEMETRY_STREAM_PROCESS, values);
+}
+
+//
+// ReportAllocations prints the heap calls since the previous report, when built with ALLOC_COUNT=1.
+// In steady state they come from the IoT Hub SDK only, one message handle per flush.
+//
+static void ReportAllocations(void)
+{
+	static HRC_ALLOC_STATS last;
+	HRC_ALLOC_STATS stats;
+
+	if (HRC_AllocGetStats(&stats))
+	{
+		printf("Heap: %u allocations, %u frees, %u reallocations since last report, %u bytes live, peak %u\n",
+			stats.allocs - last.allocs, stats.frees - last.frees, stats.reallocs - last.reallocs, stats.live_bytes, stats.peak_bytes);
+		last = stats;
+	}
+}
+
+//
+// The event loop handlers.  Each one runs when its timer expires or its fd becomes readable; in between the process
+// sleeps in epoll_wait.
+//
+static void EventLoop_DoWork(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+
+	TelemetryBatch_DoWork(loopContext->batchHandle);
+	// incoming requests from the server and to do connection keep alives.
+	HRC_STATS_START(doWorkStart);
+	IoTHubDeviceClient_LL_DoWork(loopContext->deviceClient);
+	HRC_STATS_STOP(HRC_STAGE_DOWORK, doWorkStart);
+}
+
+static void EventLoop_Sensor(void* context)
+{
+	SENSOR* sensor = (SENSOR*)context;
+
+	// Consumes the INT edges, or reads INT_STATUS once when there is no INT line.
+	if (HRC_IrqWait(&sensor->device.irq, &sensor->device, 0) > 0)
+	{
+		HRC_Drain(&sensor->device);
+		HRC_Process(&sensor->device);
+	}
+}
+
+static void EventLoop_Poll(void* context)
+{
+	SENSOR* sensor = (SENSOR*)context;
+	uint32_t interval;
+
+	HRC_Drain(&sensor->device);
+	HRC_Process(&sensor->device);
+
+	// The next drain follows the fill level this one found.
+	interval = HRC_DrainInterval(&sensor->device);
+	if (interval != sensor->drainSource->period_us)
+	{
+		(void)HRC_LoopSetPeriod(&g_eventLoop, sensor->drainSource, interval);
+	}
+}
+
+static void EventLoop_Process(void* context)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		if (HRC_AcqRunning(&g_sensors[i].device))
+		{
+			HRC_Process(&g_sensors[i].device);
+		}
+	}
+}
+
+static void EventLoop_Metrics(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+	HRC_METRICS_SAMPLE sample;
+
+	if (HRC_MetricsSample(&g_processMetrics, &sample) == 0)
+	{
+		TempControlComponent_SendWorkingSet(loopContext->batchHandle, &sample);
+		SendProcessMetrics(loopContext, &sample);
+		g_lastMetrics = sample;
+	}
+	ReportAllocations();
+}
+
+static void EventLoop_Temperature(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+	uint32_t i;
+
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		ThermostatComponent_SendCurrentTemperature(Handle1, loopContext->batchHandle, &g_sensors[i].device, SensorNumber(&g_sensors[i]));
+	}
+}
+
+static void EventLoop_HeartRate(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+	uint32_t i;
+
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		HRComponent_SendHeartRate(Handle1, loopContext->batchHandle, &g_sensors[i].device, SensorNumber(&g_sensors[i]));
+	}
+}
+
+static void EventLoop_Adapt(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+	TELEMETRY_BATCH_STATS batchStats;
+	HRC_HR_RESULT heartRate;
+	HRC_ADAPT_INPUT input;
+	uint64_t now = HRC_BusNowNs();
+	SENSOR* sensor;
+	int spo2;
+	uint32_t i;
+
+	TelemetryBatch_GetStats(loopContext->batchHandle, &batchStats);
+	input.cpu_permille = g_lastMetrics.cpu_permille;
+	input.uplink_drops = batchStats.dropped + batchStats.bulkDropped + batchStats.deferred;
+
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		sensor = &g_sensors[i];
+		if (sensor->adapt.cfg.enabled == false)
+		{
+			continue;
+		}
+
+		HRC_HrGetResult(&sensor->device.hr, &heartRate);
+		input.confidence = heartRate.bpm ? heartRate.confidence : 0;
+		input.ring_fill = HRC_RingCount(&sensor->device.ring);
+		input.ring_drops = HRC_RingDrops(&sensor->device.ring);
+
+		// The drain switches the sensor over; the drain timer and the simulated INT follow from there.
+		if ((spo2 = HRC_AdaptUpdate(&sensor->adapt, &input, now)) >= 0)
+		{
+			printf("%s: %u samples/s, %s\n", sensor->device.name, HRC_AdaptRate(sensor->adapt.level), sensor->adapt.reason);
+			HRC_RequestFormat(&sensor->device, (uint8_t)spo2);
+		}
+	}
+}
+
+static void EventLoop_Stats(void* context)
+{
+	EVENT_LOOP_CONTEXT* loopContext = (EVENT_LOOP_CONTEXT*)context;
+
+	(void)HRC_StatsWrite(loopContext->statsPath);
+}
+
+static void EventLoop_Signal(int signalNumber)
+{
+	HRC_LoopStop(&g_eventLoop);
+}
+
+//
+// AddSensorSources registers what drains one sensor with g_eventLoop: nothing while its acquisition thread does, else
+// its INT source or, without one, a drain timer.
+//
+static bool AddSensorSources(SENSOR* sensor)
+{
+	bool result;
+
+	// The acquisition thread owns the INT source, the "process" timer empties the ring.
+	if (HRC_AcqRunning(&sensor->device))
+	{
+		result = true;
+	}
+	// An INT edge wakes the loop directly.  The slow drain timer catches an edge that was lost before the line was requested.
+	else if (sensor->device.irq.fd >= 0)
+	{
+		result = HRC_LoopAddFd(&g_eventLoop, "int", sensor->device.irq.fd, EventLoop_Sensor, sensor) != NULL &&
+			HRC_LoopAddTimer(&g_eventLoop, "drain", HRC_IRQ_TIMEOUT_MS * 1000, EventLoop_Sensor, sensor) != NULL;
+	}
+	// Without an INT line the FIFO is drained when it should be three quarters full; HRC_LOOP only sets the first period.
+	else
+	{
+		result = (sensor->drainSource = HRC_LoopAddTimer(&g_eventLoop, "drain", HRC_DrainInterval(&sensor->device), EventLoop_Poll, sensor)) != NULL;
+	}
+
+	return result;
+}
+
+//
+// CreateEventLoop registers the timers and the INT sources of all sensors with g_eventLoop and applies the periods
+// from the environment.  Control-C stops the loop so that main can clean up.
+//
+static bool CreateEventLoop(EVENT_LOOP_CONTEXT* loopContext)
+{
+	struct sigaction action;
+	HRC_STAGE_STATS stageStats;
+	bool acquisitionThreads = false;
+	bool result;
+	uint32_t i;
+
+	if (HRC_LoopInit(&g_eventLoop) < 0)
+	{
+		return false;
+	}
+
+	if (HRC_LoopAddTimer(&g_eventLoop, "dowork", g_doWorkPeriodMs * 1000, EventLoop_DoWork, loopContext) == NULL ||
+		HRC_LoopAddTimer(&g_eventLoop, "metrics", g_metricsPeriodMs * 1000, EventLoop_Metrics, loopContext) == NULL ||
+		HRC_LoopAddTimer(&g_eventLoop, "temperature", g_temperaturePeriodMs * 1000, EventLoop_Temperature, loopContext) == NULL ||
+		HRC_LoopAddTimer(&g_eventLoop, "heartRate", g_heartRatePeriodMs * 1000, EventLoop_HeartRate, loopContext) == NULL)
+	{
+		result = false;
+	}
+	else
+	{
+		result = true;
+		for (i = 0; i < g_sensorCount && result == true; i++)
+		{
+			result = AddSensorSources(&g_sensors[i]);
+			acquisitionThreads |= HRC_AcqRunning(&g_sensors[i].device);
+		}
+	}
 
-	int workingSet = g_workingSetMinimum + (rand() % g_workingSetRandomModulo);
+	if (result == true && acquisitionThreads == true)
+	{
+		result = HRC_LoopAddTimer(&g_eventLoop, "process", g_processPeriodMs * 1000, EventLoop_Process, loopContext) != NULL;
+	}
 
-	// Create the telemetry message body to send.
-	if (snprintf(workingSetTelemetryPayload, sizeof(workingSetTelemetryPayload), g_workingSetTelemetryFormat, workingSet) < 0)
+	for (i = 0; i < g_sensorCount && result == true; i++)
 	{
-		printf("Unable to create a workingSet telemetry payload string");
+		if (g_sensors[i].adapt.cfg.enabled == true)
+		{
+			result = HRC_LoopAddTimer(&g_eventLoop, "adapt", g_adaptPeriodMs * 1000, EventLoop_Adapt, loopContext) != NULL;
+			break;
+		}
 	}
-	// Create the message handle and specify its metadata.
-	else if ((messageHandle = IoTHubMessage_CreateFromString(workingSetTelemetryPayload)) == NULL)
+
+	if (result == true && loopContext->statsPath != NULL)
 	{
-		printf("IoTHubMessage_CreateFromString failed");
+		if (HRC_StatsGet(HRC_STAGE_I2C, &stageStats) == false)
+		{
+			printf("%s ignored, built without STATS=1\n", g_hrcStatsEnvironmentVariable);
+			loopContext->statsPath = NULL;
+		}
+		else
+		{
+			result = HRC_LoopAddTimer(&g_eventLoop, "stats", g_statsPeriodMs * 1000, EventLoop_Stats, loopContext) != NULL;
+		}
 	}
-	else if ((messageResult = IoTHubMessage_SetContentTypeSystemProperty(messageHandle, g_jsonContentType)) != IOTHUB_MESSAGE_OK)
+
+	if (result == true && HRC_LoopParseConfig(&g_eventLoop, getenv(g_hrcLoopEnvironmentVariable)) < 0)
 	{
-		printf("IoTHubMessage_SetContentTypeSystemProperty failed, error=%d", messageResult);
+		result = false;
 	}
-	else if ((messageResult = IoTHubMessage_SetContentEncodingSystemProperty(messageHandle, g_utf8EncodingType)) != IOTHUB_MESSAGE_OK)
+
+	if (result == true)
 	{
-		printf("IoTHubMessage_SetContentEncodingSystemProperty failed, error=%d", messageResult);
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = EventLoop_Signal;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
 	}
-	// Send the telemetry message.
-	else if ((iothubClientResult = IoTHubDeviceClient_LL_SendEventAsync(deviceClient, messageHandle, NULL, NULL)) != IOTHUB_CLIENT_OK)
+
+	return result;
+}
+
+//
+// ReportAcquisition prints how many samples were drained from the FIFO of a sensor, how many were lost on the way and the rate the sensor really samples at.
+//
+static void ReportAcquisition(SENSOR* sensor)
+{
+	HRC_DRAIN_STATS stats;
+
+	HRC_GetDrainStats(&sensor->device, &stats);
+	printf("%s FIFO: %u samples in %u drains (max fill %u), %u overflows (%u saturated), %u samples lost, drain interval %u us\n",
+		sensor->device.name, stats.samples, stats.drains, stats.max_fill, stats.overflows, stats.saturated, stats.lost, stats.interval_us);
+	if (stats.rate_mhz)
+		printf("%s Clock: %u.%03u samples/s measured, %+d ppm from the configured %u\n",
+			sensor->device.name, stats.rate_mhz / 1000, stats.rate_mhz % 1000, stats.drift_ppm, sensor->device.drain.rate);
+	else
+		printf("%s Clock: not measured yet\n", sensor->device.name);
+	printf("%s Ring: %u samples dropped\n", sensor->device.name, HRC_RingDrops(&sensor->device.ring));
+	if (sensor->adapt.cfg.enabled)
+		printf("%s Adapt: %u samples/s, %u raises, %u lowers\n",
+			sensor->device.name, HRC_AdaptRate(sensor->adapt.level), sensor->adapt.raises, sensor->adapt.lowers);
+}
+
+//
+// ReportTelemetryBatch prints what the batch sent and the histogram of the send-to-confirmation latency.
+//
+static void ReportTelemetryBatch(TELEMETRY_BATCH_HANDLE batchHandle)
+{
+	static const unsigned int bucketBoundsMs[TELEMETRY_LATENCY_BUCKETS - 1] = TELEMETRY_LATENCY_BUCKET_BOUNDS_MS;
+	TELEMETRY_BATCH_STATS stats;
+	int i;
+
+	TelemetryBatch_GetStats(batchHandle, &stats);
+	printf("Telemetry: %u messages (%u records), %u stored, %u replayed, %u dropped, %u failures, %u deferred\n",
+		stats.messages, stats.records, stats.stored, stats.replayed, stats.dropped, stats.failures, stats.deferred);
+	printf("Telemetry: %u bulk messages, %u dropped; %u confirmed, %u undelivered, %u in flight (max %u)\n",
+		stats.bulkMessages, stats.bulkDropped, stats.confirmed, stats.undelivered, stats.inFlight, stats.maxInFlight);
+	printf("Telemetry confirmation latency [ms]:");
+	for (i = 0; i < TELEMETRY_LATENCY_BUCKETS - 1; i++)
 	{
-		printf("Unable to send telemetry message, error=%d", iothubClientResult);
+		printf(" <=%u:%u", bucketBoundsMs[i], stats.latency[i]);
 	}
+	printf(" >%u:%u max:%u\n", bucketBoundsMs[TELEMETRY_LATENCY_BUCKETS - 2], stats.latency[TELEMETRY_LATENCY_BUCKETS - 1], stats.maxLatencyMs);
+}
 
-	IoTHubMessage_Destroy(messageHandle);
+//
+// OpenTelemetryStore opens the store selected by HRC_STORE, NULL when it is not set or cannot be used.
+//
+static TELEMETRY_STORE_HANDLE OpenTelemetryStore(void)
+{
+	TELEMETRY_STORE_CONFIG storeConfig = TELEMETRY_STORE_CONFIG_DEFAULT;
+	TELEMETRY_STORE_HANDLE storeHandle = NULL;
+	const char* storeSettings = getenv(g_telemetryStoreEnvironmentVariable);
+
+	if (storeSettings != NULL &&
+		(TelemetryStore_ParseConfig(&storeConfig, storeSettings) == false || (storeHandle = TelemetryStore_Open(&storeConfig)) == NULL))
+	{
+		printf("Telemetry is not kept while the hub is unreachable\n");
+	}
+
+	return storeHandle;
+}
+
+//
+// ReportTelemetryStore prints what went through the store and the write amplification its appends caused.
+//
+static void ReportTelemetryStore(TELEMETRY_STORE_HANDLE storeHandle)
+{
+	TELEMETRY_STORE_STATS stats;
+
+	TelemetryStore_GetStats(storeHandle, &stats);
+	printf("Telemetry store: %u appended, %u sent, %u evicted, %u refused, %u corrupt, %u left (%zu bytes)\n",
+		stats.appended, stats.removed, stats.evicted, stats.refused, stats.corrupt, stats.records, stats.bytes);
+	if (stats.payloadBytes > 0)
+	{
+		printf("Telemetry store: %llu message bytes, %llu written, %u pages programmed in %u syncs\n",
+			(unsigned long long)stats.payloadBytes, (unsigned long long)stats.writtenBytes, stats.pagesProgrammed, stats.syncs);
+	}
 }
 
 // CreateDeviceClientLLHandle creates the IOTHUB_DEVICE_CLIENT_LL_HANDLE based on environment configuration.
@@ -344,31 +782,178 @@ static bool AllocateThermostatComponents(void)
 	return result;
 }
 
-volatile uint8_t data_ready = 0;
+//
+// OpenSensor opens the sensor at path, or a simulated one, at slave_addr into sensor together with its INT source.
+//
+static void OpenSensor(SENSOR* sensor, const char* path, uint8_t slave_addr, const char* intSource)
+{
+	static uint32_t simulatedSensors;
+	const HRC_TRANSPORT* transport;
+	char name[16];
+	int file,rc;
 
-int main(int argc,char ** argv)
+	if (strcmp(path, g_hrcSimPath) == 0)
+	{
+		HRC_SIM_CONFIG simConfig = HRC_SIM_CONFIG_DEFAULT;
+
+		if (HRC_SimParseConfig(&simConfig, getenv(g_hrcSimEnvironmentVariable)) < 0)
+			errx(-1, "Cannot start the simulated sensor");
+
+		// Simulated sensors side by side should not produce the same noise.
+		simConfig.seed += simulatedSensors++;
+		if ((file = HRC_SimOpen(&simConfig)) < 0)
+			errx(-1, "Cannot start the simulated sensor");
+
+		transport = &HRC_TransportSim;
+	}
+	else
+	{
+		file = HRC_I2COpen(path, slave_addr);
+		if (file < 0)
+			err(errno, "Tried to open '%s' at device address '0x%02x'", path, slave_addr);
+
+		transport = &HRC_TransportI2C;
+	}
+
+	// Sensors opened through the same path share its bus, the simulated ones share one as well.
+	snprintf(name, sizeof(name), "hrc%u", (unsigned int)(sensor - g_sensors));
+	HRC_DeviceInit(&sensor->device, name, transport, file, HRC_BusGet(path));
+
+	// the simulated INT follows the model clock, which may run faster than real time
+	if (transport == &HRC_TransportSim && intSource != NULL && strcmp(intSource, "sim") == 0)
+		rc = HRC_IrqOpenSim(&sensor->device.irq, HRC_SimAFullPeriodUs(file, HRC_SampleRate(HRC_DEFAULT_SPO2)));
+	else
+		rc = HRC_IrqOpen(&sensor->device.irq, intSource);
+
+	if (rc < 0)
+	{
+		printf("%s: Falling back to polling the sensor status register\n", name);
+		HRC_IrqOpenPoll(&sensor->device.irq, HRC_IRQ_POLL_US);
+	}
+}
+
+//
+// OpenSensors opens the sensors named on the command line, each a bus path or "sim", optionally followed by its
+// I2C address, pairs them with the entries of HRC_INT_GPIO and starts them up; a sensor that cannot be configured
+// is left out.
+//
+static void OpenSensors(int argc, char** argv)
 {
+	char intSources[256];
+	const char* intSource = NULL;
+	char* nextIntSource = NULL;
+	char* separator;
+	const char* path;
 	uint8_t slave_addr;
-	const char *path = argv[1];
-	int file,rc;
+	int argument = 1;
+
+	if (getenv(g_hrcIntEnvironmentVariable) != NULL)
+	{
+		snprintf(intSources, sizeof(intSources), "%s", getenv(g_hrcIntEnvironmentVariable));
+		nextIntSource = intSources;
+	}
+
+	while (argument < argc)
+	{
+		path = argv[argument++];
+		slave_addr = HRC_I2C_ADR;
+		if (argument < argc && argv[argument][0] >= '0' && argv[argument][0] <= '9')
+			slave_addr = strtoul(argv[argument++], NULL, 0);
+
+		if (g_sensorCount == HRC_MAX_DEVICES)
+			errx(-1, "At most %d sensors", HRC_MAX_DEVICES);
+
+		// the last entry stays in use once the list runs out
+		if (nextIntSource != NULL)
+		{
+			intSource = nextIntSource;
+			if ((separator = strchr(nextIntSource, ',')) != NULL)
+			{
+				*separator = 0;
+				nextIntSource = separator + 1;
+			}
+			else
+			{
+				nextIntSource = NULL;
+			}
+		}
+
+		OpenSensor(&g_sensors[g_sensorCount], path, slave_addr, intSource);
+
+		// an unconfigured sensor is not drained, its slot goes to the next one
+		if (HRC_Startup(&g_sensors[g_sensorCount].device) < 0)
+		{
+			printf("%s: cannot be configured, skipped\n", g_sensors[g_sensorCount].device.name);
+			HRC_DeviceClose(&g_sensors[g_sensorCount].device);
+			continue;
+		}
+		g_sensorCount++;
+	}
+
+	if (g_sensorCount == 0)
+		errx(-1, "No sensor could be configured");
+}
+
+int main(int argc,char ** argv)
+{
+	const char *acqSettings;
+	const char *dspName;
+	HRC_ADAPT_CONFIG adaptConfig = HRC_ADAPT_CONFIG_DEFAULT;
+	const HRC_DSP *dsp;
+	uint32_t i;
 
 	if (argc == 1)
-		errx(-1, "path [i2c address] [register]");
+		errx(-1, "path|sim [i2c address] [path|sim [i2c address]]...");
 
-	if (argc > 2)
-		slave_addr = strtoul(argv[2], NULL, 0);
+	OpenSensors(argc, argv);
 
-	file = open(path, O_RDWR);
-	if (file < 0)
-		err(errno, "Tried to open '%s'", path);
+	dspName = getenv(g_hrcDspEnvironmentVariable);
+	if ((dsp = HRC_DspByName(dspName)) == NULL)
+	{
+		printf("Signal kernels '%s' not available\n", dspName);
+	}
+	HRC_SetDsp(dsp);
+	printf("Signal kernels: %s\n", HRC_GetDsp()->name);
 
-	rc = ioctl(file, I2C_SLAVE, slave_addr);
-	if (rc < 0)
-		err(errno, "Tried to set device address '0x%02x'", slave_addr);
+	if (HRC_AdaptParseConfig(&adaptConfig, getenv(g_hrcAdaptEnvironmentVariable)) < 0)
+	{
+		printf("Sample rate stays fixed\n");
+		adaptConfig.enabled = false;
+	}
 
-	HRC_Startup(file);
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		HRC_AdaptInit(&g_sensors[i].adapt, &adaptConfig, g_sensors[i].device.drain.spo2);
+	}
+	// The FIFOs of the first sensors overflowed while the later ones started up.
+	for (i = 0; i + 1 < g_sensorCount; i++)
+	{
+		HRC_ResetFifo(&g_sensors[i].device);
+	}
+
+	if ((acqSettings = getenv(g_hrcAcqEnvironmentVariable)) != NULL)
+	{
+		HRC_ACQ_CONFIG acqConfig = HRC_ACQ_CONFIG_DEFAULT;
+
+		if (HRC_AcqParseConfig(&acqConfig, acqSettings) < 0)
+		{
+			printf("Sensor acquisition threads not started\n");
+		}
+		else
+		{
+			for (i = 0; i < g_sensorCount; i++)
+			{
+				if (HRC_AcqStart(&g_sensors[i].device, &acqConfig) < 0)
+				{
+					printf("%s: Sensor acquisition thread not started\n", g_sensors[i].device.name);
+				}
+			}
+		}
+	}
 
 	IOTHUB_DEVICE_CLIENT_LL_HANDLE deviceClient = NULL;
+	TELEMETRY_BATCH_HANDLE batchHandle = NULL;
+	TELEMETRY_BATCH_CONFIG batchConfig = TELEMETRY_BATCH_CONFIG_DEFAULT;
 
 	g_DeviceConfiguration.modelId = g_temperatureControllerModelId; 
 	g_DeviceConfiguration.enableTracing = g_hubClientTraceEnabled;
@@ -389,23 +974,71 @@ int main(int argc,char ** argv)
 		ThermostatComponent_Destroy(Handle1);
 	}
 
+	else if (TelemetryBatch_ParseConfig(&batchConfig, getenv(g_telemetryBatchEnvironmentVariable)) == false ||
+		TelemetryBatch_ParseEncoding(&batchConfig, getenv(g_telemetryEncodingEnvironmentVariable)) == false ||
+		(batchHandle = TelemetryBatch_Create(deviceClient, &batchConfig)) == NULL)
+	{
+		printf("Failure creating telemetry batch");
+		ThermostatComponent_Destroy(Handle1);
+		IoTHubDeviceClient_LL_Destroy(deviceClient);
+	}
+
 	else
 	{
-		printf("Successfully created device client.  Hit Control-C to exit program\n");
-		int numberOfIterations = 0;
+		TELEMETRY_STORE_HANDLE storeHandle = OpenTelemetryStore();
+		EVENT_LOOP_CONTEXT loopContext = { deviceClient, batchHandle, storeHandle, getenv(g_hrcStatsEnvironmentVariable) };
+		const char* waveform = getenv(g_hrcWaveformEnvironmentVariable);
 
-		while (true)
+		if (storeHandle != NULL)
 		{
-			// incoming requests from the server and to do connection keep alives.
-			if ((numberOfIterations % g_sendTelemetryPollInterval) == 0)
+			TelemetryBatch_SetStore(batchHandle, storeHandle);
+		}
+
+		// Without /proc the metrics timer sends nothing.
+		(void)HRC_MetricsOpen(&g_processMetrics);
+
+		if (waveform != NULL && strcmp(waveform, "1") == 0)
+		{
+			for (i = 0; i < g_sensorCount; i++)
 			{
-				TempControlComponent_SendWorkingSet(deviceClient);
-				ThermostatComponent_SendCurrentTemperature(Handle1, deviceClient, file);
-				sleep(1);
+				HRComponent_InitWaveform(&g_sensors[i].waveform, batchHandle, SensorNumber(&g_sensors[i]));
+				HRC_SetWaveformSink(&g_sensors[i].device, HRComponent_SendWaveform, &g_sensors[i].waveform);
 			}
+		}
 
-			IoTHubDeviceClient_LL_DoWork(deviceClient);
-			numberOfIterations++;
+		if (CreateEventLoop(&loopContext) == false)
+		{
+			printf("Failure creating event loop");
+		}
+		else
+		{
+			printf("Successfully created device client.  Hit Control-C to exit program\n");
+			(void)HRC_LoopRun(&g_eventLoop);
+			HRC_LoopDump(&g_eventLoop);
+		}
+
+		HRC_LoopClose(&g_eventLoop);
+		HRC_MetricsClose(&g_processMetrics);
+		HRC_AcqStop();
+		for (i = 0; i < g_sensorCount; i++)
+		{
+			ReportAcquisition(&g_sensors[i]);
+			HRC_SetWaveformSink(&g_sensors[i].device, NULL, NULL);
+		}
+		HRC_BusDump();
+
+		// Send what is still queued, or keep it in the store.
+		(void)TelemetryBatch_Flush(batchHandle);
+		ReportTelemetryBatch(batchHandle);
+		TelemetryBatch_Destroy(batchHandle);
+		if (loopContext.statsPath != NULL)
+		{
+			(void)HRC_StatsWrite(loopContext.statsPath);
+		}
+		if (storeHandle != NULL)
+		{
+			ReportTelemetryStore(storeHandle);
+			TelemetryStore_Close(storeHandle);
 		}
 
 		// Free the memory allocated to track simulated thermostat.
@@ -417,5 +1050,10 @@ int main(int argc,char ** argv)
 		IoTHub_Deinit();
 	}
 
+	for (i = 0; i < g_sensorCount; i++)
+	{
+		HRC_DeviceClose(&g_sensors[i].device);
+	}
+
 	return 0;
 }